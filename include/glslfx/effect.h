@@ -30,12 +30,36 @@
 
 #include <GL/glew.h>
 #include <GL/gl.h>
+#include <glslfx/include_cache.h>
+#include <glslfx/shader_cache.h>
+#include <glslfx/string_view.h>
 #include <map>
 #include <vector>
 #include <string>
 
 namespace glslfx {
 
+	class thread_pool;
+	class path_table;
+	class path_resolver;
+	class baked_effect;
+	class name_index;
+
+	/**
+	 * Handle of a technique, see effect::technique_find.
+	 */
+	typedef unsigned int technique_id;
+
+	/**
+	 * Flags for minification of shader sources.
+	 * @see effect::set_minify
+	 */
+	enum minify_t {
+		MINIFY_NONE = 0,
+		MINIFY_WHITESPACE = 1,      /* strip comments, blank lines and redundant whitespace */
+		MINIFY_DEAD_FUNCTIONS = 2   /* also remove functions unreachable from main */
+	};
+
 	/**
 	 * Vertex layout description.
 	 */
@@ -55,15 +79,19 @@ namespace glslfx {
 			typedef std::pair<std::string, technique*> pair;
 			typedef std::map<std::string, technique*> map;
 
-			/* filename-table storage */
-			typedef std::pair<std::string, unsigned int> file_entry;
-			typedef std::vector<file_entry> file_table;
+			/* reverse dependency index, path to all passes using it */
+			typedef std::map<std::string, std::vector<pass*> > dependant_map;
 
 		public:
 			typedef map::const_iterator const_iterator;
 			typedef map::iterator iterator;
 
 			effect(const std::string& filename);
+
+			/**
+			 * Releases the programs of all passes. If the effect has been
+			 * compiled the context must be current.
+			 */
 			~effect();
 
 			/**
@@ -71,21 +99,164 @@ namespace glslfx {
 			 */
 			int parse();
 
+			/**
+			 * Parse an effect from memory, eg. read from an archive or a
+			 * network cache. The buffer is only used during the call. Paths
+			 * referenced by the effect are still relative to the directory
+			 * of the filename given to the constructor.
+			 * @param data Contents of an fx-file, need not be null-terminated.
+			 * @param size
+			 */
+			int parse_buffer(const char* data, size_t size);
+
+			/**
+			 * Load an effect written by bake() instead of parsing it. The
+			 * file is mapped and the techniques, passes and expanded sources
+			 * are used directly from the mapping, nothing is parsed or
+			 * preprocessed. If the baked file is missing, invalid or if any
+			 * file it was built from has changed since, the effect is parsed
+			 * as usual.
+			 * @param path Baked file.
+			 * @return 0 if successful (either way) or the error from parse().
+			 */
+			int load_baked(const std::string& path);
+
+			/**
+			 * Write the parsed effect with all sources expanded to a baked
+			 * file, see load_baked(). Sources are expanded without pass
+			 * macros and without minification.
+			 * @param path Output file, replaced atomically.
+			 * @param log Preprocessing errors (if non-null).
+			 */
+			int bake(const std::string& path, log_sink* log) const;
+
+			/**
+			 * Read all shader sources and (transitively) included files into
+			 * the include cache before compiling. Each level of the include
+			 * tree is read as a single batch (using io_uring where available)
+			 * so the latency of cold files overlaps instead of being paid one
+			 * file at a time. Includes in disabled branches are read as well.
+			 * Files which cannot be read are skipped, compile reports them.
+			 */
+			int prefetch();
+
 			/**
 			 * Compiles the effect shaders, if log is present (non-null) validation report is written to it.
+			 * Shader sources are preprocessed in parallel and then compiled in order on the calling thread.
 			 */
-			int compile(log* log);
+			int compile(log_sink* log);
+
+			/**
+			 * Minify shader sources before they are passed to the driver (see
+			 * minify_t). Line numbers in the driver log are still mapped back
+			 * to the original files. Takes effect on the next compile.
+			 * @param flags
+			 */
+			void set_minify(unsigned int flags);
+			unsigned int minify() const;
+
+			/**
+			 * Set the number of threads used to preprocess shader sources.
+			 * Only applies to the thread pool owned by the effect.
+			 * @param n Number of threads, 0 (default) to use one per processor.
+			 */
+			void set_threads(unsigned int n);
+
+			/**
+			 * Preprocess using another thread pool, eg. one shared by all
+			 * effects in the process so idle threads aren't kept for each
+			 * effect. The pool must outlive the effect. Passing NULL reverts
+			 * to the pool owned by the effect.
+			 */
+			void set_thread_pool(thread_pool* pool);
 
 			const std::string& filename() const;
 			const std::string& dirref() const;
 
 			/**
-			 * Resolve a path referenced in an effect.
+			 * Resolve a path referenced in an effect. Relative paths are
+			 * looked up in the directory of the effect followed by the
+			 * include paths, in order. The result is canonicalized and
+			 * cached, so each distinct reference only touches the filesystem
+			 * once.
 			 */
 			std::string resolve_path(const std::string& in) const;
 
 			/**
-			 * Create a new technique.
+			 * Append a directory to the include search path. Relative
+			 * directories are relative to the directory of the effect. Must not
+			 * be called while the effect is compiling.
+			 */
+			void add_include_path(const std::string& dir);
+
+			void clear_include_paths();
+
+			const std::vector<std::string>& include_paths() const;
+
+			/**
+			 * Store a path in the path table of the effect. Handles are only
+			 * valid for this effect and the table is freed along with it.
+			 * May be used from several threads at once.
+			 * @param path Path to store.
+			 * @param handle Returns the handle.
+			 */
+			int path_store(const std::string& path, unsigned int& handle) const;
+
+			/**
+			 * Retrieve a path stored in the path table of the effect.
+			 * @return 0 on success or E_NOT_FOUND if the handle is invalid.
+			 */
+			int path_retrieve(unsigned int handle, std::string& path) const;
+
+			/**
+			 * Get the include cache used when expanding shader sources.
+			 */
+			include_cache* includes() const;
+
+			/**
+			 * Use another include cache, eg. one shared by all effects in the
+			 * process. The cache must outlive the effect. Passing NULL reverts
+			 * to the cache owned by the effect.
+			 */
+			void set_include_cache(include_cache* cache);
+
+			/**
+			 * Get the provider files are read from, NULL if they are read
+			 * from the filesystem.
+			 */
+			const file_provider* files() const;
+
+			/**
+			 * Read the fx-file, shader sources, includes and baked effects
+			 * through a provider, eg. an archive. The provider must outlive
+			 * the effect. Passing NULL reverts to the filesystem.
+			 */
+			void set_file_provider(const file_provider* files);
+
+			/**
+			 * Get the cache of compiled shaders and programs.
+			 */
+			shader_cache* shaders() const;
+
+			/**
+			 * Use another shader cache, eg. one shared by all effects using
+			 * the same context. The cache must outlive the effect, which
+			 * releases its programs when destroyed. Passing NULL reverts to
+			 * the cache owned by the effect.
+			 */
+			void set_shader_cache(shader_cache* cache);
+
+			/**
+			 * Get all passes which used a file (resolved path) in any shader
+			 * the last time the effect was compiled.
+			 * @return 0 on success or E_NOT_FOUND if no pass depends on path.
+			 */
+			int dependants(const std::string& path, std::vector<pass*>& dst) const;
+
+			/**
+			 * Create a new technique. If there already is a technique with
+			 * the name it is returned instead, eg. passes of a technique
+			 * declared twice are added to the first one.
 			 */
 			technique* technique_new(const std::string& name);
 
@@ -94,6 +265,25 @@ namespace glslfx {
 			 */
 			technique* technique_get(const std::string& name);
 
+			/**
+			 * Get the handle of a technique. Handles are assigned in the
+			 * order techniques are created and stay valid as long as the
+			 * effect lives, so they can be resolved once (eg. when a material
+			 * is loaded) and used with technique_at() afterwards.
+			 * @return 0 if successful or E_NOT_FOUND.
+			 */
+			int technique_find(const string_view& name, technique_id& dst) const;
+
+			/**
+			 * Get a technique by handle, or NULL if the handle isn't valid.
+			 */
+			technique* technique_at(technique_id id) const;
+
+			/**
+			 * Number of techniques, valid handles are below this.
+			 */
+			size_t technique_count() const;
+
 			const_iterator technique_begin() const;
 			const_iterator technique_end() const;
 			iterator technique_begin();
@@ -116,14 +306,61 @@ namespace glslfx {
 			bool is_valid() const;
 
 		private:
-			int parse_fx(FILE* fp);
+			friend class reloader;
+			friend class pass;
+
+			int parse_fx(const char* data, size_t size);
+
+			/**
+			 * Check and build the effect from a mapped baked file.
+			 * @return 0 if successful, E_BAKED_INVALID or E_BAKED_STALE.
+			 */
+			int load_baked(baked_effect* src);
+
+			/**
+			 * Stop using baked sources, eg. when files have changed.
+			 */
+			void discard_baked();
+
+			/**
+			 * Rebuild the reverse dependency index from the passes.
+			 */
+			void index_dependants();
+
+			/**
+			 * Preprocess a single shader, run by the thread pool.
+			 */
+			static void preprocess(void* data, size_t index);
+
+			/**
+			 * Get the thread pool used for preprocessing.
+			 */
+			thread_pool* pool() const;
 
 			std::string _filename; /* filename of the effect */
 			std::string _dirref;   /* the directory the filename resides in and all paths referenced in the
 									* effect are relative to. */
 
 			map _techniques;
-			file_table _file_table;
+			std::vector<technique*> _technique_table; /* techniques by handle */
+			name_index* _technique_index;             /* technique name to handle */
+			path_table* _file_table;     /* paths referenced by line maps of this effect */
+			path_resolver* _resolver;    /* resolves and caches referenced paths */
+			dependant_map _dependants;
+
+			include_cache _own_includes; /* include cache owned by this effect */
+			include_cache* _includes;    /* include cache in use */
+
+			shader_cache _own_shaders;   /* shader cache owned by this effect */
+			shader_cache* _shaders;      /* shader cache in use */
+
+			const file_provider* _files; /* NULL for the filesystem */
+
+			unsigned int _minify;        /* minify_t flags */
+			unsigned int _threads;       /* number of preprocessing threads */
+			mutable thread_pool* _own_pool; /* thread pool owned by this effect, created on first use */
+			thread_pool* _pool;             /* thread pool in use, NULL for the owned one */
+			baked_effect* _baked;        /* baked file the effect was loaded from, or NULL */
 	};
 
 }
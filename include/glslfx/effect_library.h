@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GLSL_FX_EFFECT_LIBRARY_H
+#define __GLSL_FX_EFFECT_LIBRARY_H
+
+#include <glslfx/include_cache.h>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace glslfx {
+
+	class thread_pool;
+
+	/**
+	 * Loads many effects at once. All fx-files added to the library are
+	 * parsed in parallel by a pool of threads and the effects which parsed
+	 * successfully are kept, in the order the files were added. The effects
+	 * share an include cache so files included by several effects are only
+	 * read and scanned once, and a thread pool.
+	 *
+	 * Nothing is compiled, GL calls must be made on the thread owning the
+	 * context so compiling the effects is left to the caller.
+	 */
+	class effect_library {
+	private:
+		typedef std::vector<effect*> vector;
+		typedef std::map<std::string, effect*> map;
+
+	public:
+		typedef vector::const_iterator const_iterator;
+		typedef vector::iterator iterator;
+
+		effect_library();
+		~effect_library();
+
+		/**
+		 * Add an fx-file to load on the next call to load(). Files which
+		 * are already loaded are ignored.
+		 */
+		void add(const std::string& filename);
+
+		/**
+		 * Add all fx-files (ending with .glslfx) in a directory, in order
+		 * of their names. Subdirectories are not searched.
+		 */
+		int add_directory(const std::string& path);
+
+		/**
+		 * Parse all files added since the last call. Files which cannot be
+		 * read or parsed are reported to log (if non-null), one message
+		 * each and in the order they were added, and are left out of the
+		 * library.
+		 * @return 0 if all files were loaded or the error of the first file
+		 *         which failed.
+		 */
+		int load(log_sink* log);
+
+		/**
+		 * Get a loaded effect by the filename it was added with, or NULL.
+		 */
+		effect* get(const std::string& filename) const;
+
+		/**
+		 * Number of loaded effects.
+		 */
+		size_t size() const;
+
+		const_iterator begin() const;
+		const_iterator end() const;
+		iterator begin();
+		iterator end();
+
+		/**
+		 * Get the include cache shared by all effects of the library.
+		 */
+		include_cache* includes();
+
+		/**
+		 * Read all files through a provider, see effect::set_file_provider.
+		 * Applies to effects loaded afterwards.
+		 */
+		void set_file_provider(const file_provider* files);
+
+		/**
+		 * Set the number of threads used to parse files and, by the loaded
+		 * effects, to preprocess shaders.
+		 * @param n Number of threads, 0 (default) to use one per processor.
+		 */
+		void set_threads(unsigned int n);
+
+	private:
+		effect_library(const effect_library&);
+		effect_library& operator=(const effect_library&);
+
+		/**
+		 * Parse a single file, run by the thread pool.
+		 */
+		static void load_job(void* data, size_t index);
+
+		/**
+		 * Get the thread pool shared by the library and its effects.
+		 */
+		thread_pool* pool();
+
+		vector _effects;                   /* loaded effects, in order */
+		map _names;                        /* loaded effects by filename */
+		std::vector<std::string> _pending; /* files added since the last load */
+		include_cache _includes;
+		const file_provider* _files;
+		unsigned int _threads;
+		thread_pool* _pool;                /* created on first use */
+	};
+
+}
+
+#endif /* __GLSL_FX_EFFECT_LIBRARY_H */
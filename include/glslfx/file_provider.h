@@ -0,0 +1,147 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __GLSL_FX_FILE_PROVIDER_H
+#define __GLSL_FX_FILE_PROVIDER_H
+
+#include <glslfx/include_cache.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace glslfx {
+
+	class mapped_file;
+	struct archive_entry;
+
+	/**
+	 * Source of the files an effect reads: the fx-file, shader sources,
+	 * includes and baked effects. Providers are used from several threads
+	 * at once so implementations must be thread-safe.
+	 * @see effect::set_file_provider
+	 */
+	class file_provider {
+	public:
+		/**
+		 * An open file. The contents stay valid until the file is closed.
+		 */
+		typedef struct {
+			const char* data;
+			size_t size;
+			include_cache::identity id; /* identity used to validate cached files */
+			void* handle;               /* private to the provider */
+		} file;
+
+		virtual ~file_provider();
+
+		/**
+		 * Open a file for reading.
+		 * @param path Resolved path.
+		 * @param dst Output
+		 * @return 0 if successful or errno, eg. ENOENT.
+		 */
+		virtual int open(const std::string& path, file& dst) const = 0;
+
+		/**
+		 * Close a file opened by this provider.
+		 */
+		virtual void close(file& src) const = 0;
+
+		/**
+		 * Get the identity of a file without reading it, also used to tell
+		 * if a file exists.
+		 * @return 0 if successful or errno, eg. ENOENT.
+		 */
+		virtual int stat(const std::string& path, include_cache::identity& dst) const = 0;
+	};
+
+	/**
+	 * Reads files from the filesystem, memory-mapped when possible. Same as
+	 * not using a provider at all.
+	 */
+	class filesystem_provider: public file_provider {
+	public:
+		virtual int open(const std::string& path, file& dst) const;
+		virtual void close(file& src) const;
+		virtual int stat(const std::string& path, include_cache::identity& dst) const;
+	};
+
+	/**
+	 * Serves files from a packed archive (see pack()). The archive is
+	 * mapped once and files are returned directly from the mapping without
+	 * copying or any further system calls. Files are looked up by their
+	 * canonical path, the same path they had when packed.
+	 */
+	class archive_provider: public file_provider {
+	public:
+		archive_provider();
+		virtual ~archive_provider();
+
+		/**
+		 * Map an archive, replacing any previous archive. Must not be
+		 * called while files from the previous archive are in use.
+		 * @return 0 if successful, errno or E_PARSE_ERROR if the file isn't
+		 *         a valid archive.
+		 */
+		int load(const std::string& path);
+
+		/**
+		 * Number of files in the archive.
+		 */
+		size_t size() const;
+
+		virtual int open(const std::string& path, file& dst) const;
+		virtual void close(file& src) const;
+		virtual int stat(const std::string& path, include_cache::identity& dst) const;
+
+		/**
+		 * Write an archive. Files are stored by their canonical path (see
+		 * effect::resolve_path), so pack the paths as the effects would
+		 * resolve them.
+		 * @param dst Archive to write, replaced atomically.
+		 * @param files Files to store, duplicates are stored once.
+		 */
+		static int pack(const std::string& dst, const std::vector<std::string>& files);
+
+	private:
+		archive_provider(const archive_provider&);
+		archive_provider& operator=(const archive_provider&);
+
+		/**
+		 * Find the directory entry of a path, or NULL.
+		 */
+		const archive_entry* find(const std::string& path) const;
+
+		mapped_file* _archive;
+		include_cache::identity _id; /* identity of the archive itself */
+		const char* _names;          /* name blob */
+		const archive_entry* _dir;   /* sorted directory */
+		size_t _size;                /* number of entries */
+	};
+
+}
+
+#endif /* __GLSL_FX_FILE_PROVIDER_H */
@@ -31,9 +31,21 @@
 namespace glslfx {
 
 	class effect;
+	class effect_library;
+	class include_cache;
+	class file_provider;
+	class filesystem_provider;
+	class archive_provider;
 	class log;
+	class log_sink;
+	class file_sink;
+	class count_sink;
 	class technique;
 	class pass;
+	class reloader;
+	class shader_cache;
+	class thread_pool;
+	class string_view;
 
 }
 
@@ -37,10 +37,18 @@
 #include <GL/glew.h>
 #include <GL/gl.h>
 #include <glslfx/forward.h>
+#include <glslfx/string_view.h>
+#include <glslfx/log_sink.h>
 #include <glslfx/log.h>
+#include <glslfx/include_cache.h>
+#include <glslfx/file_provider.h>
+#include <glslfx/shader_cache.h>
+#include <glslfx/thread_pool.h>
 #include <glslfx/pass.h>
 #include <glslfx/technique.h>
 #include <glslfx/effect.h>
+#include <glslfx/effect_library.h>
+#include <glslfx/reloader.h>
 
 /**
  */
@@ -57,8 +65,16 @@ namespace glslfx {
 		E_TOKEN_ERROR = -2,
 
 		/* general errors */
-		E_NOT_FOUND = -1001,
-		E_NOT_SET   = -1002
+		E_NOT_FOUND    = -1001,
+		E_NOT_SET      = -1002,
+		E_OUT_OF_RANGE = -1003,
+
+		/* errors relating to preprocessing of shader sources */
+		E_INCLUDE_CYCLE = -2001,
+
+		/* errors relating to baked effects */
+		E_BAKED_INVALID = -3001, /* not a baked effect or another version */
+		E_BAKED_STALE   = -3002  /* a file it was built from has changed */
 	};
 
 	enum vendor_t {
@@ -78,7 +94,12 @@ namespace glslfx {
 	typedef unsigned int path_handle_t;
 
 	/**
-	 * Store a path in the path database.
+	 * Store a path in the process-wide path database, for strings which
+	 * are shared between effects. Paths used by an effect are kept in its
+	 * own table instead (see effect::path_store) so they are freed along
+	 * with the effect. Storing the same path again
+	 * returns the same handle. The database may be used from several
+	 * threads at once, looking up paths already stored never blocks.
 	 * @param path Path to store.
 	 * @param handle Returns the handle.
 	 */
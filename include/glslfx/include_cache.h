@@ -0,0 +1,206 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GLSL_FX_INCLUDE_CACHE_H
+#define __GLSL_FX_INCLUDE_CACHE_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace glslfx {
+
+	class mapped_file;
+	class file_provider;
+
+	/**
+	 * Cache of scanned source files, shared by all passes which include
+	 * the same file. Entries are keyed by the resolved path and validated
+	 * against the file identity (device, inode, mtime and size), so a
+	 * modified file is never served from the cache. The cache may be used
+	 * from several threads at once.
+	 */
+	class include_cache {
+	public:
+		/**
+		 * Identity of a file on disk.
+		 */
+		typedef struct {
+			dev_t dev;
+			ino_t ino;
+			time_t mtime;
+			long mtime_nsec; /* 0 if the filesystem lacks sub-second times */
+			off_t size;
+		} identity;
+
+		/**
+		 * A piece of a scanned file, either a span of the file itself, an
+		 * include directive or a preprocessor directive which is evaluated
+		 * when the file is used.
+		 */
+		typedef struct {
+			enum type_t {
+				SPAN, INCLUDE,
+
+				/* directives, the piece spans the entire line */
+				VERSION, DEFINE, UNDEF,
+				IF, IFDEF, IFNDEF, ELIF, ELSE, ENDIF
+			};
+
+			type_t type;
+			size_t offset;     /* INCLUDE: offset of the referenced path in file,
+			                    * others: offset in file */
+			size_t size;       /* length in bytes */
+			unsigned int line; /* SPAN: line of the first line, INCLUDE and
+			                    * directives: line of the directive */
+			unsigned int lines; /* SPAN: number of lines, others: 1 */
+		} piece;
+
+		/**
+		 * A scanned source file. The pieces references the mapped file
+		 * rather than copying it. Includes are only recorded as references
+		 * and expanded once the file is used in a translation unit, so the
+		 * scan itself is independent of where (and by which effect) the
+		 * file is included.
+		 */
+		typedef struct {
+			unsigned int lines;   /* number of lines in the file */
+			identity id;          /* identity of the file when it was scanned */
+			uint64_t hash;        /* hash of the file contents */
+			mapped_file* file;    /* source file, kept mapped as long as the entry lives */
+			std::vector<piece> pieces; /* the scanned file, in order */
+			bool once;            /* file contains #pragma once */
+			std::string guard;    /* include guard macro or empty if the file isn't guarded */
+		} entry;
+
+		/**
+		 * Keeps entries which are replaced while the scope lives from being
+		 * freed, as sources expanded within the scope may point into them.
+		 * Replaced entries are freed when the last scope of the cache ends.
+		 * Scopes may be nested and opened from several threads.
+		 */
+		class scope {
+		public:
+			scope(include_cache* cache);
+			~scope();
+
+		private:
+			scope(const scope&);
+			scope& operator=(const scope&);
+
+			include_cache* _cache;
+		};
+
+		include_cache();
+		~include_cache();
+
+		/**
+		 * Find a scanned file. Returns NULL if the file isn't cached or if
+		 * it has been modified since it was stored.
+		 * @param path Resolved path.
+		 * @param files Provider the file is read from, NULL for the
+		 *              filesystem.
+		 */
+		const entry* find(const std::string& path, const file_provider* files = NULL);
+
+		/**
+		 * Store a scanned file, replacing any previous entry. The cache
+		 * takes ownership of the entry and its file.
+		 * @param path Resolved path.
+		 * @param src Entry to store, allocated with new.
+		 * @return The stored entry.
+		 */
+		const entry* store(const std::string& path, entry* src);
+
+		/**
+		 * Drop all entries (counters are left alone). Must not be called
+		 * while sources referencing the entries are still in use.
+		 */
+		void clear();
+
+		/**
+		 * Number of replaced entries waiting to be freed.
+		 */
+		size_t retired() const;
+
+		/**
+		 * Number of lookups served from the cache.
+		 */
+		unsigned int hits() const;
+
+		/**
+		 * Number of lookups which had to read the file from disk.
+		 */
+		unsigned int misses() const;
+
+		/**
+		 * Get the identity of a file on disk.
+		 * @param path
+		 * @param dst Output
+		 */
+		static int stat(const std::string& path, identity& dst);
+
+		/**
+		 * Get the identity of a file from its status.
+		 * @param st
+		 * @param dst Output
+		 */
+		static void stat(const struct stat& st, identity& dst);
+
+		/**
+		 * Tells whenever two identities refer to the same file contents.
+		 */
+		static bool same(const identity& a, const identity& b);
+
+	private:
+		friend class scope;
+
+		include_cache(const include_cache&);
+		include_cache& operator=(const include_cache&);
+
+		typedef std::map<std::string, entry*> map;
+		typedef std::pair<std::string, entry*> pair;
+		typedef map::iterator iterator;
+
+		void retire(iterator it);
+
+		map _entries;
+		std::vector<entry*> _retired; /* replaced entries, sources built from
+		                               * them may still point into them. */
+		unsigned int _scopes;         /* number of open scopes */
+		unsigned int _hits;
+		unsigned int _misses;
+		pthread_mutex_t _lock;
+	};
+
+}
+
+#endif /* __GLSL_FX_INCLUDE_CACHE_H */
@@ -28,96 +28,214 @@
 #ifndef __GLSL_FX_LOG_H
 #define __GLSL_FX_LOG_H
 
+#include <glslfx/string_view.h>
+#include <glslfx/log_sink.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <map>
+#include <utility>
 #include <string>
 #include <vector>
-#include <cstdarg>
 
 namespace glslfx {
 
-	class log {
+	/**
+	 * Message log, a sink which buffers all messages until they are read.
+	 * Messages can be written from several threads at once without locking,
+	 * each thread writes to a buffer of its own. The buffers are merged when
+	 * the log is read, ordered by the scope (see log::scope) the messages
+	 * were written in, so the result does not depend on how the threads were
+	 * scheduled. Reading while another thread writes is not safe.
+	 *
+	 * Entries are kept compact: file names and reference numbers are
+	 * interned once per log and message text is stored in an arena owned by
+	 * the log, so writing a message does not allocate per entry. All views
+	 * returned by the log stay valid until the log is cleared or destroyed.
+	 */
+	class log: public log_sink {
 	public:
 		/**
-		 * Entry structure. If generic is set to true the entry just contains
-		 * a message and all the other fields is undefined.
+		 * Entry structure. Strings are resolved through the log, see file(),
+		 * ref() and text().
 		 */
 		typedef struct {
-			bool generic;         /* whenever this is a full log message or just
-			                       * a generic message, in which case only the
-			                       * message field is usable. */
-			unsigned int line;    /* line the message refers to */
-			std::string file;     /* file the message refers to */
-			std::string severity; /* severity (error, warning etc) */
-			std::string ref;      /* reference number (eg #C1234) */
-			std::string message;  /* actual message */
+			severity_t severity;      /* SEVERITY_NONE for generic messages */
+			unsigned int line;        /* line the message refers to */
+			unsigned int file;        /* interned file the message refers to */
+			unsigned int ref;         /* interned reference number (eg #C1234) */
+			const char* message;      /* null-terminated text, owned by the log */
+			unsigned int message_len;
 		} entry;
 
+		/**
+		 * Position of messages when the log is merged. Messages are ordered
+		 * by batch, then by position and last by the order they were
+		 * written in. Messages written outside of any scope form a batch of
+		 * their own, ie. they are kept in the order they were written
+		 * relative to other batches.
+		 */
+		typedef struct {
+			uint64_t batch;    /* see next_batch(), 0 if not in a scope */
+			uint64_t position; /* see position() */
+		} order_t;
+
+		/**
+		 * Sets the order of all messages written by the current thread
+		 * while the scope lives. Scopes may be nested, the innermost scope
+		 * is used.
+		 */
+		class scope {
+		public:
+			scope(const order_t& order);
+			~scope();
+
+		private:
+			friend class log;
+
+			scope(const scope&);
+			scope& operator=(const scope&);
+
+			order_t _order;
+			scope* _prev;
+		};
+
 	private:
 		typedef std::vector<entry> vector;
+		struct thread_buffer;
 
 	public:
 		typedef vector::const_iterator const_iterator;
 		typedef vector::iterator iterator;
 
 		log();
+		log(const log& src);
 		~log();
 
+		log& operator=(const log& src);
+
 		const_iterator begin() const;
 		const_iterator end() const;
 		iterator begin();
 		iterator end();
 
 		/**
-		 * Write a message to the log.
-		 * @param line
-		 * @param file
-		 * @param severity
-		 * @param ref
-		 * @param message
+		 * Number of entries.
+		 */
+		size_t size() const;
+
+		/**
+		 * Drop all entries and their text.
+		 */
+		void clear();
+
+		/**
+		 * File of an entry, empty for generic messages. Null-terminated.
+		 */
+		string_view file(const entry& entry) const;
+
+		/**
+		 * Reference number of an entry, may be empty. Null-terminated.
+		 */
+		string_view ref(const entry& entry) const;
+
+		/**
+		 * Message text of an entry. Null-terminated.
+		 */
+		string_view text(const entry& entry) const;
+
+		/**
+		 * Start a new batch. Batches sort after all messages written
+		 * before they were started.
+		 */
+		static uint64_t next_batch();
+
+		/**
+		 * Pack the indices of the effect, technique, pass and stage a
+		 * message belongs to into a position (16 bits each).
 		 */
-		void message(unsigned int line,
-					 const std::string& file,
-					 const std::string& severity,
-					 const std::string& ref,
-					 const std::string& message);
+		static uint64_t position(unsigned int effect, unsigned int technique, unsigned int pass, unsigned int stage);
 
 		/**
-		 * Write a printf-style formated message to the log.
-		 * @param line
-		 * @param file
-		 * @param severity
-		 * @param ref
-		 * @param fmt
+		 * Order of the current thread, the batch is 0 outside of a scope.
 		 */
-		void format(unsigned int line,
-					const std::string& file,
-					const std::string& severity,
-					const std::string& ref,
-					const char* fmt, ...);
+		static order_t current_order();
 
 		/**
-		 * Write a printf-style formated message to the log.
-		 * @param line
-		 * @param file
-		 * @param severity
-		 * @param ref
-		 * @param fmt
-		 * @param ap
+		 * Name of a severity, eg. "error".
 		 */
-		void vformat(unsigned int line,
-					 const std::string& file,
-					 const std::string& severity,
-					 const std::string& ref,
-					 const char* fmt, va_list ap);
+		static const char* severity_name(severity_t severity);
 
 		/**
-		 * Write a generic message to the log.
-		 * @param message
+		 * Get the severity from a name reported by a driver (case
+		 * insensitive), unrecognized names are treated as information.
 		 */
-		void generic(const std::string& message);
+		static severity_t parse_severity(const string_view& name);
 
+		virtual void write(unsigned int line,
+						   const string_view& file,
+						   severity_t severity,
+						   const string_view& ref,
+						   const string_view& message);
+
+		/**
+		 * The log orders messages itself, see log::scope.
+		 */
+		virtual bool ordered() const;
 
 	private:
+		/**
+		 * Merge key of an entry.
+		 */
+		typedef struct {
+			uint64_t batch;
+			uint64_t position;
+			uint64_t sequence;
+		} key;
+
+		typedef std::pair<key, entry> record;
+
+		static bool record_less(const record& a, const record& b);
+
+		/**
+		 * Get the buffer of the calling thread, created on first use.
+		 */
+		thread_buffer* buffer();
+
+		/**
+		 * Merge the thread buffers into the entries.
+		 */
+		void sync();
+
+		/**
+		 * Append an entry, lock must be held.
+		 */
+		void push(unsigned int line,
+				  const string_view& file,
+				  severity_t severity,
+				  const string_view& ref,
+				  const string_view& message);
+
+		/**
+		 * Copy a string into the arena, lock must be held.
+		 */
+		const char* store(const string_view& str);
+
+		/**
+		 * Get the handle of a string, storing it if needed. Lock must be
+		 * held.
+		 */
+		unsigned int intern(const string_view& str);
+
+		void release();
+
 		vector _entries;
+		std::vector<key> _keys;          /* merge key of each entry, sorted */
+		thread_buffer* volatile _buffers; /* lock-free list of thread buffers */
+		std::vector<char*> _chunks;      /* arena, chunks are never moved */
+		size_t _chunk_used;              /* bytes used in the last chunk */
+		std::vector<string_view> _interned;           /* by handle, 0 is the empty string */
+		std::map<uint64_t, unsigned int> _intern_index; /* hash to handle */
+		pthread_mutex_t _lock; /* protects the entries while merging */
 	};
 
 }
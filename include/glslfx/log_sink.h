@@ -0,0 +1,188 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __GLSL_FX_LOG_SINK_H
+#define __GLSL_FX_LOG_SINK_H
+
+#include <glslfx/string_view.h>
+#include <pthread.h>
+#include <cstdio>
+#include <cstdarg>
+
+namespace glslfx {
+
+	class log;
+
+	/**
+	 * Severity of a log message.
+	 */
+	enum severity_t {
+		SEVERITY_NONE = 0, /* generic message, only the text is set */
+		SEVERITY_INFO,
+		SEVERITY_WARNING,
+		SEVERITY_ERROR,
+
+		SEVERITY_MAX
+	};
+
+	/**
+	 * Receiver of diagnostics. Messages are passed to the sink one at a time
+	 * as they are produced, the sink decides whenever they are kept, written
+	 * somewhere or just counted. Sinks may be written from several threads at
+	 * once so implementations must be thread-safe.
+	 * @see log (buffers all messages)
+	 */
+	class log_sink {
+	public:
+		virtual ~log_sink();
+
+		/**
+		 * Receive a message. The views are only valid during the call.
+		 * @param line Line the message refers to.
+		 * @param file File the message refers to, empty for generic messages.
+		 * @param severity
+		 * @param ref Reference number, may be empty.
+		 * @param message Message text, empty if the sink doesn't want text.
+		 */
+		virtual void write(unsigned int line,
+						   const string_view& file,
+						   severity_t severity,
+						   const string_view& ref,
+						   const string_view& message) = 0;
+
+		/**
+		 * Tell if the sink uses the message text of a severity. If not,
+		 * writers skip formatting it. Default is true.
+		 */
+		virtual bool wants_text(severity_t severity) const;
+
+		/**
+		 * Tell if the sink orders messages by scope itself (see log::scope)
+		 * so writers on several threads may write to it directly and still
+		 * get a deterministic order. Otherwise writers buffer the messages of
+		 * each thread and write them in order. Default is false.
+		 */
+		virtual bool ordered() const;
+
+		/**
+		 * Write a message to the sink.
+		 */
+		void message(unsigned int line,
+					 const string_view& file,
+					 severity_t severity,
+					 const string_view& ref,
+					 const string_view& message);
+
+		/**
+		 * Write a printf-style formated message to the sink.
+		 */
+		void format(unsigned int line,
+					const string_view& file,
+					severity_t severity,
+					const string_view& ref,
+					const char* fmt, ...);
+
+		/**
+		 * Write a printf-style formated message to the sink.
+		 */
+		void vformat(unsigned int line,
+					 const string_view& file,
+					 severity_t severity,
+					 const string_view& ref,
+					 const char* fmt, va_list ap);
+
+		/**
+		 * Write a generic message to the sink.
+		 * @param message
+		 */
+		void generic(const string_view& message);
+
+		/**
+		 * Write all messages buffered in a log to the sink, in order.
+		 * @param src
+		 */
+		void append(const log& src);
+	};
+
+	/**
+	 * Writes each message to a stream as soon as it is received, eg.
+	 * "foo.glsl:12 error C1008: undefined variable".
+	 */
+	class file_sink: public log_sink {
+	public:
+		/**
+		 * @param fp Stream to write to, not closed by the sink.
+		 */
+		file_sink(FILE* fp);
+
+		virtual void write(unsigned int line,
+						   const string_view& file,
+						   severity_t severity,
+						   const string_view& ref,
+						   const string_view& message);
+
+	private:
+		FILE* _fp;
+	};
+
+	/**
+	 * Counts messages by severity and drops them. No message text is
+	 * formatted for this sink.
+	 */
+	class count_sink: public log_sink {
+	public:
+		count_sink();
+		virtual ~count_sink();
+
+		virtual void write(unsigned int line,
+						   const string_view& file,
+						   severity_t severity,
+						   const string_view& ref,
+						   const string_view& message);
+
+		virtual bool wants_text(severity_t severity) const;
+
+		/**
+		 * Number of messages received of a severity.
+		 */
+		unsigned int count(severity_t severity) const;
+
+		/**
+		 * Reset all counters.
+		 */
+		void reset();
+
+	private:
+		count_sink(const count_sink&);
+		count_sink& operator=(const count_sink&);
+
+		unsigned int _count[SEVERITY_MAX];
+		mutable pthread_mutex_t _lock;
+	};
+
+}
+
+#endif /* __GLSL_FX_LOG_SINK_H */
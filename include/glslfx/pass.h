@@ -31,16 +31,38 @@
 #include <glslfx/log.h>
 #include <GL/glew.h>
 #include <GL/gl.h>
+#include <stdint.h>
 #include <string>
+#include <vector>
 #include <map>
 
 namespace glslfx {
 
+	class source_list;
+	struct baked_stage;
+
 	class pass {
+	public:
+		/**
+		 * A file a shader depends on.
+		 */
+		typedef struct {
+			std::string path; /* resolved path */
+			uint64_t hash;    /* hash of the file contents, 0 if it is missing */
+		} dependency;
+
+		/**
+		 * Key of a variant, a bitmask of keywords.
+		 * @see add_keyword
+		 */
+		typedef uint32_t variant_key;
+
 	private:
 		typedef struct {
 			std::string path;
 			GLuint shader;
+			std::vector<dependency> deps; /* files used by the last compile */
+			const baked_stage* baked;     /* expanded source loaded from a baked effect, or NULL */
 		} entry;
 		typedef std::pair<GLenum, entry> pair;
 		typedef std::map<GLenum, entry> map;
@@ -69,6 +91,17 @@ namespace glslfx {
 		 */
 		int source(GLenum target, std::string& dst) const;
 
+		/**
+		 * Get all files a shader was built from, the root source followed by
+		 * every file it (transitively) includes. Files in disabled
+		 * conditional branches are not listed. If preprocessing failed
+		 * because a file is missing it is listed last, so it can be watched
+		 * until it is created. Filled in by compile.
+		 * @param target Which shader to get dependencies from.
+		 * @param dst Output
+		 */
+		int dependencies(GLenum target, std::vector<dependency>& dst) const;
+
 		/**
 		 * Get the OpenGL handle to the shader program, or 0 if the program
 		 * hasn't been properly compiled yet.
@@ -94,12 +127,74 @@ namespace glslfx {
 		void set_path(GLenum target, const std::string& path);
 
 		/**
-		 * Compile shader program.
+		 * Define a preprocessor macro for all shaders in the pass. Macros
+		 * are evaluated by the preprocessor so branches which are disabled
+		 * are never read or sent to the driver.
+		 * @param name
+		 * @param value
+		 */
+		void set_define(const std::string& name, const std::string& value = "1");
+
+		/**
+		 * Remove a macro previously defined with set_define.
+		 * @param name
 		 */
-   		int compile(log* log);
+		void unset_define(const std::string& name);
 
 		/**
-		 * Set the vertex layout.
+		 * Declare a keyword, a macro which variants can toggle. It is
+		 * defined (as 1) in all variants with the keywords bit set in the
+		 * key. A pass can have at most 32 keywords.
+		 * @param name
+		 * @return 0 if successful or E_OUT_OF_RANGE if there are too many
+		 *         keywords.
+		 */
+		int add_keyword(const std::string& name);
+
+		/**
+		 * Get the bit for a keyword. Keys are formed by or-ing the bits of
+		 * all enabled keywords, so resolve the bits once and reuse them.
+		 * @param name
+		 * @param dst Output
+		 */
+		int keyword(const std::string& name, variant_key& dst) const;
+
+		/**
+		 * Get the program for a variant, it is built the first time it is
+		 * requested. Variants which preprocess to identical sources share
+		 * the same program.
+		 * @param key Keywords to enable.
+		 * @param program Output
+		 * @param log Preprocessing and compilation messages (if non-null).
+		 */
+		int variant(variant_key key, GLuint& program, log_sink* log = NULL);
+
+		/**
+		 * Build several variants at once. Sources are preprocessed in
+		 * parallel and then compiled on the calling thread. Variants already
+		 * built are skipped.
+		 * @param keys
+		 * @param n Number of keys.
+		 * @param log Preprocessing and compilation messages (if non-null).
+		 */
+		int prepare_variants(const variant_key* keys, size_t n, log_sink* log);
+
+		/**
+		 * Bind the program of a variant (building it if needed) and the
+		 * layout.
+		 * @param vertices A pointer to a stream of vertices.
+		 * @param key Keywords to enable.
+		 */
+		int bind(const GLvoid* vertices, variant_key key);
+
+		/**
+		 * Compile shader program. Existing variants are discarded and
+		 * rebuilt when next requested.
+		 */
+   		int compile(log_sink* log);
+
+		/**
+		 * Set the vertex layout. Existing variants are discarded.
 		 * @param layout Pointer to an array of layout descriptions.
 		 * @param Size of the vertex structure, eg a single vertex.
 		 * @param n Size of layout array,
@@ -114,14 +209,24 @@ namespace glslfx {
 
 	private:
 		friend class technique;
+		friend class effect;
 
 		typedef struct {
+			std::string name; /* name of attribute */
 			GLint attrib;     /* shader attribute index */
 			GLint components; /* number of components. 1-4 */
 			GLenum type;      /* datatype of attribute */
 			off_t offset;     /* offset in struct */
 		} layout_entry;
 
+		typedef std::map<std::string, std::string> define_map;
+
+		typedef struct {
+			variant_key key;
+			GLuint program;
+			bool used;
+		} variant_entry;
+
 		pass(const effect* ep, const std::string& name);
 
 		/**
@@ -129,10 +234,60 @@ namespace glslfx {
 		 */
 		int find_entry(GLenum target, entry& dst) const;
 
+		/**
+		 * Get the processed source for a given shader as a list of
+		 * segments. Files used are written to deps and preprocessing errors
+		 * to log (if non-null).
+		 */
+		int source(GLenum target, source_list& dst, std::vector<dependency>* deps, log_sink* log) const;
+
+		/**
+		 * Same as above but using another set of macros.
+		 */
+		int source(GLenum target, const define_map& defines, source_list& dst, std::vector<dependency>* deps, log_sink* log) const;
+
+		/**
+		 * Expand the source of a shader without minifying it. Sources
+		 * loaded from a baked effect are used as-is when no macros are
+		 * defined, as they were expanded without any.
+		 */
+		int expand(GLenum target, const define_map& defines, source_list& dst, std::vector<dependency>* deps, log_sink* log) const;
+
+		/**
+		 * Compile and link already preprocessed sources, one for each
+		 * shader in map order. Must be called from the GL thread.
+		 */
+		int submit(const std::vector<source_list*>& src, log_sink* log);
+
+		/**
+		 * Compile sources and link them into a new program. Compiled
+		 * shaders are written to shader (in map order).
+		 */
+		int build(const std::vector<source_list*>& src, std::vector<GLuint>& shader, GLuint& sp, GLint& status, log_sink* log) const;
+
+		/**
+		 * Bind a program and the layout.
+		 */
+		void use(GLuint sp, const GLvoid* vertices) const;
+
+		/**
+		 * Preprocess a single shader of a variant, run by the thread pool.
+		 */
+		static void preprocess_variant(void* data, size_t index);
+
+		const variant_entry* find_variant(variant_key key) const;
+		void insert_variant(variant_key key, GLuint program);
+		void clear_variants();
+
 		const effect* ep; /* owner */
 
 		const std::string _name; /* name of the pass */
 		map _shader;             /* map of shader resouces */
+		define_map _defines;     /* preprocessor macros */
+		std::vector<std::string> _keywords;          /* variant keywords, by bit */
+		std::vector<variant_entry> _variants;        /* open addressed table of built variants */
+		size_t _num_variants;
+		std::map<uint64_t, GLuint> _variant_program; /* variant programs by source hash */
 
 		GLuint _sp;              /* shader program */
 
@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GLSL_FX_RELOADER_H
+#define __GLSL_FX_RELOADER_H
+
+#include <glslfx/include_cache.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+namespace glslfx {
+
+	/**
+	 * Watches the files an effect was built from and recompiles the passes
+	 * affected by a change. Uses inotify where available and falls back to
+	 * comparing file identities on each update. Files which are missing,
+	 * eg. an include which hasn't been written yet, are watched as well.
+	 *
+	 * Passes keep their current program until the rebuilt program has been
+	 * linked successfully.
+	 */
+	class reloader {
+	public:
+		reloader(effect* ep);
+		~reloader();
+
+		/**
+		 * Start watching the effect file and all files used by the passes
+		 * the last time the effect was compiled. Can be called again to
+		 * watch files added since, eg. after recompiling the effect.
+		 */
+		int watch();
+
+		/**
+		 * Get a descriptor which becomes readable when a watched file has
+		 * changed, for use with poll/select. -1 if not supported.
+		 */
+		int fd() const;
+
+		/**
+		 * Process pending changes (never blocks) and recompile all affected
+		 * passes. Compilation errors are written to log (if non-null).
+		 * @return 0 if successful or an error code from the first pass
+		 *         which failed preprocessing.
+		 */
+		int update(log_sink* log);
+
+		/**
+		 * Tells whenever the effect file itself has changed. Techniques and
+		 * passes are not recreated by the reloader so the effect has to be
+		 * parsed again by the caller.
+		 */
+		bool effect_changed() const;
+
+		/**
+		 * Number of passes recompiled by the last update.
+		 */
+		unsigned int rebuilt() const;
+
+	private:
+		reloader(const reloader&);
+		reloader& operator=(const reloader&);
+
+		typedef std::map<std::string, include_cache::identity> file_map;
+		typedef std::map<std::string, int> dir_map;
+		typedef std::map<int, std::set<std::string> > watch_map;
+
+		/**
+		 * Add a file to the watch list.
+		 */
+		int add(const std::string& path);
+
+		/**
+		 * Collect changed paths since the last call.
+		 */
+		int changes(std::vector<std::string>& dst);
+
+		effect* ep;              /* effect being watched */
+		int _fd;                 /* inotify descriptor (or -1) */
+		file_map _files;         /* watched files and their identity */
+		dir_map _dirs;           /* watched directories as referenced, -1 if missing */
+		watch_map _watches;      /* watch descriptor to all references of its directory */
+		bool _effect_changed;
+		unsigned int _rebuilt;
+	};
+
+}
+
+#endif /* __GLSL_FX_RELOADER_H */
@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GLSL_FX_SHADER_CACHE_H
+#define __GLSL_FX_SHADER_CACHE_H
+
+#include <GL/glew.h>
+#include <GL/gl.h>
+#include <stdint.h>
+#include <vector>
+#include <map>
+
+namespace glslfx {
+
+	/**
+	 * Compiled shader objects and linked programs keyed by the hash of their
+	 * sources, so passes with identical shaders share the same objects.
+	 * Shaders are owned by the cache and kept alive as long as a program
+	 * uses them, programs are reference counted.
+	 *
+	 * GL objects can only be shared within a single context (or share
+	 * group) and the cache must only be used from the thread the context is
+	 * current in.
+	 */
+	class shader_cache {
+	public:
+		shader_cache();
+		~shader_cache();
+
+		/**
+		 * Find a compiled shader.
+		 * @return The shader or 0 if there is none.
+		 */
+		GLuint shader(GLenum target, uint64_t hash) const;
+
+		/**
+		 * Add a compiled shader, the cache takes ownership of it.
+		 */
+		void add_shader(GLenum target, uint64_t hash, GLuint shader);
+
+		/**
+		 * Find a linked program and add a reference to it.
+		 * @return The program or 0 if there is none.
+		 */
+		GLuint program(uint64_t key);
+
+		/**
+		 * Add a linked program with a single reference, the cache takes
+		 * ownership of it. The shaders are kept until the program is
+		 * released.
+		 */
+		void add_program(uint64_t key, GLuint program, const std::vector<GLuint>& shaders);
+
+		/**
+		 * Release a reference to a program. When the last reference is
+		 * released the program and all shaders no longer used are deleted.
+		 */
+		void release(GLuint program);
+
+		/**
+		 * Delete all shaders and programs, regardless of references. The
+		 * context must be current. The destructor doesn't touch GL so this
+		 * must be called to free the objects.
+		 */
+		void clear();
+
+		/**
+		 * Number of shaders in the cache.
+		 */
+		size_t shaders() const;
+
+		/**
+		 * Number of programs in the cache.
+		 */
+		size_t programs() const;
+
+	private:
+		shader_cache(const shader_cache&);
+		shader_cache& operator=(const shader_cache&);
+
+		typedef std::pair<GLenum, uint64_t> shader_key;
+
+		typedef struct {
+			GLuint shader;
+			unsigned int refs;  /* number of programs using it */
+		} shader_entry;
+
+		typedef struct {
+			uint64_t key;
+			unsigned int refs;
+			std::vector<shader_key> shaders;
+		} program_entry;
+
+		std::map<shader_key, shader_entry> _shaders;
+		std::map<GLuint, shader_key> _shader_names;
+		std::map<uint64_t, GLuint> _program_keys;
+		std::map<GLuint, program_entry> _programs;
+	};
+
+}
+
+#endif /* __GLSL_FX_SHADER_CACHE_H */
@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __GLSL_FX_STRING_VIEW_H
+#define __GLSL_FX_STRING_VIEW_H
+
+#include <cstring>
+#include <string>
+
+namespace glslfx {
+
+	/**
+	 * Non-owning reference to a string. The referenced memory must outlive
+	 * the view.
+	 */
+	class string_view {
+	public:
+		string_view()
+			: _data("")
+			, _size(0) {
+
+		}
+
+		string_view(const char* str)
+			: _data(str)
+			, _size(strlen(str)) {
+
+		}
+
+		string_view(const char* data, size_t size)
+			: _data(data)
+			, _size(size) {
+
+		}
+
+		string_view(const std::string& str)
+			: _data(str.data())
+			, _size(str.size()) {
+
+		}
+
+		const char* data() const { return _data; }
+		size_t size() const { return _size; }
+		bool empty() const { return _size == 0; }
+
+		/**
+		 * Copy into a string.
+		 */
+		std::string str() const { return std::string(_data, _size); }
+
+		bool operator==(const string_view& rhs) const {
+			return _size == rhs._size && memcmp(_data, rhs._data, _size) == 0;
+		}
+
+		bool operator!=(const string_view& rhs) const {
+			return !(*this == rhs);
+		}
+
+	private:
+		const char* _data;
+		size_t _size;
+	};
+
+}
+
+#endif /* __GLSL_FX_STRING_VIEW_H */
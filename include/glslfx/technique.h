@@ -28,11 +28,19 @@
 #ifndef __GLSL_FX_TECHNIQUE_H
 #define __GLSL_FX_TECHNIQUE_H
 
+#include <glslfx/string_view.h>
 #include <string>
 #include <vector>
 
 namespace glslfx {
 
+	class name_index;
+
+	/**
+	 * Handle of a pass within its technique, see technique::pass_find.
+	 */
+	typedef unsigned int pass_id;
+
 	class technique {
 	private:
 		typedef std::vector<pass*> vector;
@@ -51,10 +59,33 @@ namespace glslfx {
 		 */
 		pass* pass_new(const std::string& name);
 
+		/**
+		 * Get an existing pass by name, the first one if several passes
+		 * share the name.
+		 */
+		pass* pass_get(const std::string& name) const;
+
+		/**
+		 * Get the handle of a pass, which is its position in the technique.
+		 * Handles stay valid as long as the effect lives.
+		 * @return 0 if successful or E_NOT_FOUND.
+		 */
+		int pass_find(const string_view& name, pass_id& dst) const;
+
+		/**
+		 * Get a pass by handle, or NULL if the handle isn't valid.
+		 */
+		pass* pass_at(pass_id id) const;
+
+		/**
+		 * Number of passes, valid handles are below this.
+		 */
+		size_t pass_count() const;
+
 		/**
 		 * Compile technique.
 		 */
-   		int compile(log* log);
+   		int compile(log_sink* log);
 
 		const_iterator pass_begin() const;
 		const_iterator pass_end() const;
@@ -76,10 +107,14 @@ namespace glslfx {
 		friend class effect;
 
 		technique(const effect* ep, const std::string& name);
+		technique(const technique&);
+		technique& operator=(const technique&);
+
 		const effect* ep; /* owner */
 
 		const std::string _name;
 		vector _pass;
+		name_index* _pass_index; /* pass name to handle */
 	};
 
 }
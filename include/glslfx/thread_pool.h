@@ -0,0 +1,101 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GLSL_FX_THREAD_POOL_H
+#define __GLSL_FX_THREAD_POOL_H
+
+#include <pthread.h>
+#include <cstddef>
+#include <vector>
+
+namespace glslfx {
+
+	/**
+	 * Fixed set of worker threads running batches of independent jobs. The
+	 * threads are started on the first batch and sleep between batches. A
+	 * pool can be shared by several effects (see effect::set_thread_pool).
+	 */
+	class thread_pool {
+	public:
+		typedef void (*func_t)(void* data, size_t index);
+
+		/**
+		 * @param threads Number of threads (including the caller) to run
+		 *                jobs on, 0 to use one per online processor.
+		 */
+		thread_pool(unsigned int threads);
+		~thread_pool();
+
+		/**
+		 * Call func(data, i) for every i in [0, n) and wait for all calls to
+		 * finish. The calling thread takes part in running the jobs. Only a
+		 * single batch runs at a time, concurrent callers wait for the
+		 * current batch to finish. Must not be called from a job.
+		 */
+		int run(size_t n, func_t func, void* data);
+
+		unsigned int threads() const;
+
+		/**
+		 * Number of online processors.
+		 */
+		static unsigned int processors();
+
+	private:
+		thread_pool(const thread_pool&);
+		thread_pool& operator=(const thread_pool&);
+
+		static void* worker(void* arg);
+
+		/**
+		 * Run jobs from the current batch until none remains.
+		 */
+		void work();
+
+		int start();
+
+		unsigned int _threads;
+		std::vector<pthread_t> _workers;
+
+		pthread_mutex_t _lock;
+		pthread_cond_t _wake;   /* signaled when a batch is started or on shutdown */
+		pthread_cond_t _done;   /* signaled when the last job of a batch finishes */
+		pthread_cond_t _idle;   /* signaled when a batch is finished */
+
+		/* current batch, protected by _lock */
+		func_t _func;
+		void* _data;
+		size_t _n;
+		size_t _next;           /* next job to run */
+		size_t _finished;       /* number of finished jobs */
+		unsigned int _batch;    /* batch counter, lets workers tell batches apart */
+		bool _quit;
+	};
+
+}
+
+#endif /* __GLSL_FX_THREAD_POOL_H */
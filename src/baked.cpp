@@ -0,0 +1,529 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "baked.h"
+#include "glslfx/effect.h"
+#include "glslfx/glslfx.h"
+#include "glslfx/technique.h"
+#include "glslfx/pass.h"
+#include "source_list.h"
+#include "hash.h"
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <map>
+
+baked_effect::baked_effect(){
+
+}
+
+baked_effect::~baked_effect(){
+	for ( std::vector<baked_stage*>::iterator it = stages.begin(); it != stages.end(); ++it ){
+		delete *it;
+	}
+}
+
+/**
+ * Size of a record in each section.
+ */
+static const size_t record_size[baked::SECTION_MAX] = {
+	sizeof(baked::technique),
+	sizeof(baked::pass),
+	sizeof(baked::keyword),
+	sizeof(baked::stage),
+	sizeof(baked::path),
+	sizeof(baked::dependency),
+	sizeof(baked::run),
+	1
+};
+
+static size_t align(size_t offset){
+	return (offset + 7) & ~(size_t)7;
+}
+
+/**
+ * Sections of a baked effect while it is being written.
+ */
+typedef struct {
+	std::vector<baked::technique> techniques;
+	std::vector<baked::pass> passes;
+	std::vector<baked::keyword> keywords;
+	std::vector<baked::stage> stages;
+	std::vector<baked::path> paths;
+	std::vector<baked::dependency> deps;
+	std::vector<baked::run> runs;
+	std::string strings;
+	std::map<std::string, uint32_t> path_index;
+} writer;
+
+static baked::str store_string(writer& w, const std::string& str){
+	baked::str tmp;
+	tmp.offset = w.strings.size();
+	tmp.size = str.size();
+	w.strings.append(str);
+	return tmp;
+}
+
+/**
+ * Get the index of a path, storing it if it isn't stored yet.
+ */
+static uint32_t store_path(writer& w, const std::string& name, uint64_t hash){
+	std::map<std::string, uint32_t>::const_iterator it = w.path_index.find(name);
+	if ( it != w.path_index.end() ){
+		return it->second;
+	}
+
+	baked::path tmp;
+	tmp.name = store_string(w, name);
+	tmp.hash = hash;
+
+	const uint32_t index = w.paths.size();
+	w.paths.push_back(tmp);
+	w.path_index[name] = index;
+	return index;
+}
+
+static int write_section(FILE* fp, const void* data, size_t size, size_t& offset){
+	static const char zero[8] = {0};
+	const size_t pad = align(offset) - offset;
+
+	if ( fwrite(zero, 1, pad, fp) != pad || ( size > 0 && fwrite(data, 1, size, fp) != size ) ){
+		return errno ? errno : EIO;
+	}
+
+	offset += pad + size;
+	return 0;
+}
+
+int effect::bake(const std::string& path, log_sink* log) const {
+	include_cache::scope scope(_includes);
+	writer w;
+	mapped_file fx;
+	baked::header header;
+	int ret;
+
+	memset(&header, 0, sizeof(header));
+
+	/* the effect itself is checked when loading */
+	if ( ( ret = fx.open(_files, _filename) ) != 0 ){
+		return ret;
+	}
+	header.effect_hash = glslfx::hash(fx.data(), fx.size());
+
+	for ( const_iterator it = technique_begin(); it != technique_end(); ++it ){
+		const technique* tech = it->second;
+		baked::technique t;
+
+		t.name = store_string(w, tech->name());
+		t.first_pass = w.passes.size();
+		t.num_passes = 0;
+
+		for ( technique::const_iterator p = tech->pass_begin(); p != tech->pass_end(); ++p, ++t.num_passes ){
+			const pass* cur = *p;
+			baked::pass bp;
+
+			bp.name = store_string(w, cur->name());
+			bp.first_keyword = w.keywords.size();
+			bp.num_keywords = cur->_keywords.size();
+			bp.first_stage = w.stages.size();
+			bp.num_stages = 0;
+
+			for ( std::vector<std::string>::const_iterator k = cur->_keywords.begin(); k != cur->_keywords.end(); ++k ){
+				baked::keyword tmp;
+				tmp.name = store_string(w, *k);
+				w.keywords.push_back(tmp);
+			}
+
+			for ( pass::const_iterator s = cur->_shader.begin(); s != cur->_shader.end(); ++s, ++bp.num_stages ){
+				std::vector<pass::dependency> deps;
+				source_list src;
+				std::string text;
+				baked::stage bs;
+
+				if ( ( ret = cur->expand(s->first, pass::define_map(), src, &deps, log) ) != 0 ){
+					return ret;
+				}
+				src.str(text);
+
+				bs.target = s->first;
+				bs.lines = src.lines().lines();
+				bs.path = store_string(w, s->second.path);
+				bs.source = store_string(w, text);
+				bs.first_dep = w.deps.size();
+				bs.num_deps = deps.size();
+				bs.first_run = w.runs.size();
+				bs.num_runs = src.lines().runs();
+
+				for ( std::vector<pass::dependency>::const_iterator d = deps.begin(); d != deps.end(); ++d ){
+					baked::dependency tmp;
+					tmp.path = store_path(w, d->path, d->hash);
+					w.deps.push_back(tmp);
+				}
+
+				/* all files in the line map are dependencies as well */
+				for ( size_t i = 0; i < bs.num_runs; i++ ){
+					unsigned int handle;
+					std::string name;
+					baked::run tmp;
+
+					src.lines().run_at(i, tmp.first, handle, tmp.line);
+					if ( ( ret = path_retrieve(handle, name) ) != 0 ){
+						return ret;
+					}
+
+					tmp.path = store_path(w, name, 0);
+					w.runs.push_back(tmp);
+				}
+
+				w.stages.push_back(bs);
+			}
+
+			w.passes.push_back(bp);
+		}
+
+		w.techniques.push_back(t);
+	}
+
+	/* lay out the sections after the header */
+	const void* data[baked::SECTION_MAX] = {
+		w.techniques.empty() ? NULL : &w.techniques[0],
+		w.passes.empty() ? NULL : &w.passes[0],
+		w.keywords.empty() ? NULL : &w.keywords[0],
+		w.stages.empty() ? NULL : &w.stages[0],
+		w.paths.empty() ? NULL : &w.paths[0],
+		w.deps.empty() ? NULL : &w.deps[0],
+		w.runs.empty() ? NULL : &w.runs[0],
+		w.strings.data()
+	};
+	const size_t count[baked::SECTION_MAX] = {
+		w.techniques.size(), w.passes.size(), w.keywords.size(), w.stages.size(),
+		w.paths.size(), w.deps.size(), w.runs.size(), w.strings.size()
+	};
+
+	size_t offset = sizeof(baked::header);
+	for ( int i = 0; i < baked::SECTION_MAX; i++ ){
+		offset = align(offset);
+		header.sections[i].offset = offset;
+		header.sections[i].count = count[i];
+		offset += count[i] * record_size[i];
+	}
+
+	memcpy(header.magic, baked::magic, sizeof(header.magic));
+	header.version = baked::version;
+	header.endian = baked::endian;
+	header.size = offset;
+
+	/* written to a temporary file so readers never see a partial file */
+	const std::string tmp = path + ".tmp";
+	FILE* fp = fopen(tmp.c_str(), "wb");
+	if ( !fp ){
+		return errno;
+	}
+
+	offset = 0;
+	ret = write_section(fp, &header, sizeof(header), offset);
+	for ( int i = 0; ret == 0 && i < baked::SECTION_MAX; i++ ){
+		ret = write_section(fp, data[i], count[i] * record_size[i], offset);
+	}
+
+	if ( fclose(fp) != 0 && ret == 0 ){
+		ret = errno;
+	}
+
+	if ( ret == 0 && rename(tmp.c_str(), path.c_str()) != 0 ){
+		ret = errno;
+	}
+
+	if ( ret != 0 ){
+		remove(tmp.c_str());
+	}
+
+	return ret;
+}
+
+/**
+ * Get a string from the string section, false if it is out of bounds.
+ */
+static bool get_string(const baked::header* header, const char* data, const baked::str& src, string_view& dst){
+	const baked::section& strings = header->sections[baked::SECTION_STRING];
+
+	if ( src.offset > strings.count || src.size > strings.count - src.offset ){
+		return false;
+	}
+
+	dst = string_view(data + strings.offset + src.offset, src.size);
+	return true;
+}
+
+template <class T>
+static const T* get_section(const baked::header* header, const char* data, int index){
+	return (const T*)(data + header->sections[index].offset);
+}
+
+/**
+ * Check that the header, all sections and all references between records
+ * are within bounds, so the records can be used without further checks.
+ */
+static bool validate(const char* data, size_t size){
+	const baked::header* header = (const baked::header*)data;
+	string_view tmp;
+
+	if ( size < sizeof(baked::header) ||
+		 memcmp(header->magic, baked::magic, sizeof(header->magic)) != 0 ||
+		 header->version != baked::version ||
+		 header->endian != baked::endian ||
+		 header->size != size ){
+		return false;
+	}
+
+	for ( int i = 0; i < baked::SECTION_MAX; i++ ){
+		const baked::section& cur = header->sections[i];
+		if ( cur.offset % 8 != 0 || cur.offset > size || cur.count > (size - cur.offset) / record_size[i] ){
+			return false;
+		}
+	}
+
+	uint64_t count[baked::SECTION_MAX];
+	for ( int i = 0; i < baked::SECTION_MAX; i++ ){
+		count[i] = header->sections[i].count;
+	}
+
+	const baked::technique* technique = get_section<baked::technique>(header, data, baked::SECTION_TECHNIQUE);
+	for ( uint64_t i = 0; i < count[baked::SECTION_TECHNIQUE]; i++ ){
+		const baked::technique& cur = technique[i];
+		if ( !get_string(header, data, cur.name, tmp) || cur.first_pass > count[baked::SECTION_PASS] || cur.num_passes > count[baked::SECTION_PASS] - cur.first_pass ){
+			return false;
+		}
+	}
+
+	const baked::pass* pass = get_section<baked::pass>(header, data, baked::SECTION_PASS);
+	for ( uint64_t i = 0; i < count[baked::SECTION_PASS]; i++ ){
+		const baked::pass& cur = pass[i];
+		if ( !get_string(header, data, cur.name, tmp) ||
+			 cur.first_stage > count[baked::SECTION_STAGE] || cur.num_stages > count[baked::SECTION_STAGE] - cur.first_stage ||
+			 cur.first_keyword > count[baked::SECTION_KEYWORD] || cur.num_keywords > count[baked::SECTION_KEYWORD] - cur.first_keyword ){
+			return false;
+		}
+	}
+
+	const baked::keyword* keyword = get_section<baked::keyword>(header, data, baked::SECTION_KEYWORD);
+	for ( uint64_t i = 0; i < count[baked::SECTION_KEYWORD]; i++ ){
+		if ( !get_string(header, data, keyword[i].name, tmp) ){
+			return false;
+		}
+	}
+
+	const baked::path* path = get_section<baked::path>(header, data, baked::SECTION_PATH);
+	for ( uint64_t i = 0; i < count[baked::SECTION_PATH]; i++ ){
+		if ( !get_string(header, data, path[i].name, tmp) ){
+			return false;
+		}
+	}
+
+	const baked::dependency* dep = get_section<baked::dependency>(header, data, baked::SECTION_DEPENDENCY);
+	for ( uint64_t i = 0; i < count[baked::SECTION_DEPENDENCY]; i++ ){
+		if ( dep[i].path >= count[baked::SECTION_PATH] ){
+			return false;
+		}
+	}
+
+	const baked::run* run = get_section<baked::run>(header, data, baked::SECTION_RUN);
+	for ( uint64_t i = 0; i < count[baked::SECTION_RUN]; i++ ){
+		if ( run[i].path >= count[baked::SECTION_PATH] ){
+			return false;
+		}
+	}
+
+	const baked::stage* stage = get_section<baked::stage>(header, data, baked::SECTION_STAGE);
+	for ( uint64_t i = 0; i < count[baked::SECTION_STAGE]; i++ ){
+		const baked::stage& cur = stage[i];
+		if ( !get_string(header, data, cur.path, tmp) || !get_string(header, data, cur.source, tmp) ||
+			 cur.first_dep > count[baked::SECTION_DEPENDENCY] || cur.num_deps > count[baked::SECTION_DEPENDENCY] - cur.first_dep ||
+			 cur.first_run > count[baked::SECTION_RUN] || cur.num_runs > count[baked::SECTION_RUN] - cur.first_run ){
+			return false;
+		}
+
+		/* runs must cover increasing lines within the source */
+		unsigned int prev = 0;
+		for ( uint32_t j = 0; j < cur.num_runs; j++ ){
+			const baked::run& r = run[cur.first_run + j];
+			if ( r.first <= prev || r.first > cur.lines ){
+				return false;
+			}
+			prev = r.first;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Tell if a file still has the contents it had when the effect was baked.
+ */
+static bool unchanged(const file_provider* files, const std::string& filename, uint64_t hash){
+	mapped_file file;
+
+	if ( file.open(files, filename) != 0 ){
+		return false;
+	}
+
+	return glslfx::hash(file.data(), file.size()) == hash;
+}
+
+int effect::load_baked(const std::string& path){
+	baked_effect* tmp = new baked_effect;
+	int ret;
+
+	if ( ( ret = tmp->file.open(_files, path) ) == 0 ){
+		ret = load_baked(tmp);
+	}
+
+	/* missing, broken or out of date, fall back to the fx-file */
+	if ( ret != 0 ){
+		delete tmp;
+		return parse();
+	}
+
+	delete _baked;
+	_baked = tmp;
+	return 0;
+}
+
+int effect::load_baked(baked_effect* src){
+	const char* data = src->file.data();
+	int ret;
+
+	if ( !validate(data, src->file.size()) ){
+		return E_BAKED_INVALID;
+	}
+
+	const baked::header* header = (const baked::header*)data;
+	const baked::technique* techniques = get_section<baked::technique>(header, data, baked::SECTION_TECHNIQUE);
+	const baked::pass* passes = get_section<baked::pass>(header, data, baked::SECTION_PASS);
+	const baked::keyword* keywords = get_section<baked::keyword>(header, data, baked::SECTION_KEYWORD);
+	const baked::stage* stages = get_section<baked::stage>(header, data, baked::SECTION_STAGE);
+	const baked::path* paths = get_section<baked::path>(header, data, baked::SECTION_PATH);
+	const baked::dependency* deps = get_section<baked::dependency>(header, data, baked::SECTION_DEPENDENCY);
+	const baked::run* runs = get_section<baked::run>(header, data, baked::SECTION_RUN);
+	const size_t num_techniques = header->sections[baked::SECTION_TECHNIQUE].count;
+	const size_t num_paths = header->sections[baked::SECTION_PATH].count;
+	string_view str;
+
+	/* every file the sources were built from must be unchanged, paths
+	 * referenced only by the line map has no hash */
+	if ( !unchanged(_files, _filename, header->effect_hash) ){
+		return E_BAKED_STALE;
+	}
+
+	std::vector<uint64_t> hashes(num_paths, 0);
+	for ( size_t i = 0; i < header->sections[baked::SECTION_DEPENDENCY].count; i++ ){
+		const baked::path& cur = paths[deps[i].path];
+		if ( hashes[deps[i].path] == 0 ){
+			get_string(header, data, cur.name, str);
+			if ( !unchanged(_files, str.str(), cur.hash) ){
+				return E_BAKED_STALE;
+			}
+			hashes[deps[i].path] = 1;
+		}
+	}
+
+	/* handles in the line maps are local to the effect */
+	std::vector<unsigned int> handles(num_paths);
+	for ( size_t i = 0; i < num_paths; i++ ){
+		get_string(header, data, paths[i].name, str);
+		if ( ( ret = path_store(str.str(), handles[i]) ) != 0 ){
+			return ret;
+		}
+	}
+
+	for ( size_t i = 0; i < num_techniques; i++ ){
+		const baked::technique& t = techniques[i];
+
+		get_string(header, data, t.name, str);
+		technique* tech = technique_new(str.str());
+
+		for ( uint32_t j = 0; j < t.num_passes; j++ ){
+			const baked::pass& p = passes[t.first_pass + j];
+
+			get_string(header, data, p.name, str);
+			pass* cur = tech->pass_new(str.str());
+
+			for ( uint32_t k = 0; k < p.num_keywords; k++ ){
+				get_string(header, data, keywords[p.first_keyword + k].name, str);
+				cur->add_keyword(str.str());
+			}
+
+			for ( uint32_t k = 0; k < p.num_stages; k++ ){
+				const baked::stage& s = stages[p.first_stage + k];
+				baked_stage* dst = new baked_stage;
+				src->stages.push_back(dst);
+
+				get_string(header, data, s.source, str);
+				dst->data = str.data();
+				dst->size = str.size();
+
+				/* a run lasts until the next one starts */
+				for ( uint32_t r = 0; r < s.num_runs; r++ ){
+					const baked::run& cur = runs[s.first_run + r];
+					const unsigned int end = r + 1 < s.num_runs ? runs[s.first_run + r + 1].first : s.lines + 1;
+					dst->lines.append(handles[cur.path], cur.line, end - cur.first);
+				}
+
+				for ( uint32_t d = 0; d < s.num_deps; d++ ){
+					const baked::path& path = paths[deps[s.first_dep + d].path];
+					pass::dependency tmp;
+
+					get_string(header, data, path.name, str);
+					tmp.path = str.str();
+					tmp.hash = path.hash;
+					dst->deps.push_back(tmp);
+				}
+
+				get_string(header, data, s.path, str);
+				cur->set_path(s.target, str.str());
+				cur->_shader[s.target].baked = dst;
+			}
+		}
+	}
+
+	return 0;
+}
+
+void effect::discard_baked(){
+	for ( iterator it = technique_begin(); it != technique_end(); ++it ){
+		technique* tech = it->second;
+		for ( technique::iterator p = tech->pass_begin(); p != tech->pass_end(); ++p ){
+			for ( pass::iterator s = (*p)->_shader.begin(); s != (*p)->_shader.end(); ++s ){
+				s->second.baked = NULL;
+			}
+		}
+	}
+}
@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __GLSL_FX_BAKED_H
+#define __GLSL_FX_BAKED_H
+
+#include "glslfx/pass.h"
+#include "line_map.h"
+#include "mapped_file.h"
+#include <stdint.h>
+#include <vector>
+
+namespace glslfx {
+
+	/**
+	 * Layout of a baked effect. All sections are arrays of fixed size
+	 * records at 8-byte aligned offsets from the start of the file and
+	 * records refer to each other by index, so the file can be used
+	 * directly from a read-only mapping. Strings (including the expanded
+	 * sources) are stored in a single blob and referenced by offset and
+	 * size. Integers are stored in host byte order, files from a host with
+	 * another order are rejected by the endian marker.
+	 */
+	namespace baked {
+
+		static const char magic[8] = {'G', 'L', 'S', 'L', 'F', 'X', 'B', '\0'};
+		static const uint32_t version = 1;
+		static const uint32_t endian = 0x01020304;
+
+		typedef struct {
+			uint64_t offset; /* offset in the string blob */
+			uint64_t size;
+		} str;
+
+		typedef struct {
+			uint64_t offset;
+			uint64_t count;
+		} section;
+
+		enum {
+			SECTION_TECHNIQUE,
+			SECTION_PASS,
+			SECTION_KEYWORD,
+			SECTION_STAGE,
+			SECTION_PATH,
+			SECTION_DEPENDENCY,
+			SECTION_RUN,
+			SECTION_STRING,    /* count is the size in bytes */
+
+			SECTION_MAX
+		};
+
+		typedef struct {
+			char magic[8];
+			uint32_t version;
+			uint32_t endian;
+			uint64_t size;          /* size of the entire file */
+			uint64_t effect_hash;   /* hash of the fx-file contents */
+			section sections[SECTION_MAX];
+		} header;
+
+		typedef struct {
+			str name;
+			uint32_t first_pass;
+			uint32_t num_passes;
+		} technique;
+
+		typedef struct {
+			str name;
+			uint32_t first_stage;
+			uint32_t num_stages;
+			uint32_t first_keyword;
+			uint32_t num_keywords;
+		} pass;
+
+		typedef struct {
+			str name;
+		} keyword;
+
+		typedef struct {
+			uint32_t target;      /* GLenum */
+			uint32_t lines;       /* number of lines in the source */
+			str path;             /* path as written in the effect */
+			str source;           /* expanded source */
+			uint32_t first_dep;
+			uint32_t num_deps;
+			uint32_t first_run;
+			uint32_t num_runs;
+		} stage;
+
+		/**
+		 * A file used by any stage, referenced by dependencies and line map
+		 * runs.
+		 */
+		typedef struct {
+			str name;             /* resolved path */
+			uint64_t hash;        /* hash of the file contents */
+		} path;
+
+		typedef struct {
+			uint32_t path;
+		} dependency;
+
+		typedef struct {
+			uint32_t first;       /* see line_map */
+			uint32_t path;
+			uint32_t line;
+		} run;
+
+	}
+
+	/**
+	 * Expanded source of a shader loaded from a baked effect. The source
+	 * points into the mapping of the baked file.
+	 */
+	struct baked_stage {
+		const char* data;
+		size_t size;
+		line_map lines;                       /* handles in the path table of the effect */
+		std::vector<pass::dependency> deps;
+	};
+
+	/**
+	 * A loaded baked effect, kept by the effect for as long as sources may
+	 * refer to it.
+	 */
+	class baked_effect {
+	public:
+		baked_effect();
+		~baked_effect();
+
+		mapped_file file;
+		std::vector<baked_stage*> stages;
+
+	private:
+		baked_effect(const baked_effect&);
+		baked_effect& operator=(const baked_effect&);
+	};
+
+}
+
+#endif /* __GLSL_FX_BAKED_H */
@@ -30,13 +30,35 @@
 #endif /* HAVE_CONFIG_H */
 
 #include "glslfx/effect.h"
+#include "glslfx/glslfx.h"
 #include "glslfx/log.h"
 #include "glslfx/technique.h"
+#include "glslfx/pass.h"
+#include "glslfx/thread_pool.h"
+#include "source_list.h"
+#include "path_table.h"
+#include "path_resolver.h"
+#include "mapped_file.h"
+#include "baked.h"
+#include "name_index.h"
 #include <cstdio>
+#include <algorithm>
 #include <errno.h>
 
 effect::effect(const std::string& filename)
-	: _filename(filename) {
+	: _filename(filename)
+	, _includes(&_own_includes)
+	, _shaders(&_own_shaders)
+	, _files(NULL)
+	, _minify(MINIFY_NONE)
+	, _threads(0)
+	, _own_pool(NULL)
+	, _pool(NULL)
+	, _baked(NULL) {
+
+	_file_table = new path_table;
+	_resolver = new path_resolver;
+	_technique_index = new name_index;
 
 	/* setup dirref */
 	{
@@ -47,40 +69,201 @@ effect::effect(const std::string& filename)
 			_dirref = filename.substr(0, s);
 		}
 	}
+
+	_resolver->set_base(_dirref);
 }
 
 effect::~effect(){
+	/* passes release their programs through the shader cache */
+	for ( iterator it = _techniques.begin(); it != _techniques.end(); ++it ){
+		delete it->second;
+	}
 
+	/* shaders which never made it into a program are only freed here */
+	_own_shaders.clear();
+
+	delete _own_pool;
+	delete _baked;
+	delete _file_table;
+	delete _resolver;
+	delete _technique_index;
 }
 
 int effect::parse(){
-	/* open file */
-	FILE* fp = fopen(_filename.c_str(), "r");
+	mapped_file file;
+	int ret;
 
 	/* see if file actaully exists */
-	if ( !fp ){
-		return ENOENT;
+	if ( ( ret = file.open(_files, _filename) ) != 0 ){
+		return ret;
 	}
 
-	/* parse fx-file */
+	/* parse fx-file, the mapping is only needed while parsing */
+	return parse_buffer(file.data(), file.size());
+}
+
+int effect::parse_buffer(const char* data, size_t size){
+	return parse_fx(data, size);
+}
+
+/**
+ * A single shader to preprocess.
+ */
+typedef struct {
+	pass* owner;
+	GLenum target;
+	std::vector<pass::dependency>* deps;
+	source_list src;
+	glslfx::log::order_t order; /* position of the messages in an ordered sink */
+	log_sink* sink;     /* either the ordered sink or the buffer below */
+	glslfx::log buffer; /* messages are written in order after all jobs are done */
 	int ret;
-	if ( ( ret = parse_fx(fp) ) != 0 ){
-		return ret;
+} job;
+
+void effect::preprocess(void* data, size_t index){
+	job* cur = ((job**)data)[index];
+	glslfx::log::scope scope(cur->order);
+	cur->ret = cur->owner->source(cur->target, cur->src, cur->deps, cur->sink);
+}
+
+int effect::compile(log_sink* log){
+	/* sources points into the included files until they are submitted */
+	include_cache::scope scope(_includes);
+	std::vector<job*> jobs;
+	int ret = 0;
+
+	/* an ordered sink can be written from all threads directly, messages are
+	 * ordered by (effect, technique, pass, stage) within the current batch.
+	 * The effect index is taken from the scope of the caller, if any. */
+	const bool direct = log && log->ordered();
+	glslfx::log::order_t order = glslfx::log::current_order();
+	const unsigned int index = (unsigned int)(order.position >> 48);
+	if ( order.batch == 0 ){
+		order.batch = glslfx::log::next_batch();
 	}
 
-	return 0;
+	/* preprocessing doesn't touch GL so all shaders are processed in parallel */
+	unsigned int t = 0;
+	for ( iterator it = technique_begin(); it != technique_end(); ++it, ++t ){
+		technique* tech = it->second;
+		unsigned int n = 0;
+		for ( technique::iterator p = tech->pass_begin(); p != tech->pass_end(); ++p, ++n ){
+			unsigned int stage = 0;
+			for ( pass::iterator s = (*p)->_shader.begin(); s != (*p)->_shader.end(); ++s, ++stage ){
+				job* tmp = new job;
+				tmp->owner = *p;
+				tmp->target = s->first;
+				tmp->deps = &s->second.deps;
+				tmp->order.batch = order.batch;
+				tmp->order.position = glslfx::log::position(index, t, n, stage);
+				tmp->sink = direct ? log : ( log ? &tmp->buffer : NULL );
+				tmp->ret = 0;
+				jobs.push_back(tmp);
+			}
+		}
+	}
+
+	pool()->run(jobs.size(), preprocess, jobs.empty() ? NULL : &jobs[0]);
+
+	/* submit passes to GL in order, stopping at the first failure */
+	for ( std::vector<job*>::iterator it = jobs.begin(); it != jobs.end() && ret == 0; ){
+		pass* owner = (*it)->owner;
+		std::vector<source_list*> src;
+
+		/* messages from GL follows the preprocessing messages of all stages */
+		glslfx::log::order_t submit_order = (*it)->order;
+		submit_order.position |= 0xffff;
+		glslfx::log::scope scope(submit_order);
+
+		for ( ; it != jobs.end() && (*it)->owner == owner; ++it ){
+			if ( log && !direct ){
+				log->append((*it)->buffer);
+			}
+			if ( ret == 0 ){
+				ret = (*it)->ret;
+			}
+			src.push_back(&(*it)->src);
+		}
+
+		if ( ret == 0 ){
+			ret = owner->submit(src, log);
+		}
+	}
+
+	for ( std::vector<job*>::iterator it = jobs.begin(); it != jobs.end(); ++it ){
+		delete *it;
+	}
+
+	/* passes compiled so far has updated dependencies */
+	index_dependants();
+
+	return ret;
 }
 
-int effect::compile(log* log){
-	int ret;
+void effect::set_minify(unsigned int flags){
+	_minify = flags;
+}
+
+unsigned int effect::minify() const {
+	return _minify;
+}
+
+thread_pool* effect::pool() const {
+	if ( _pool ){
+		return _pool;
+	}
+
+	if ( !_own_pool ){
+		_own_pool = new thread_pool(_threads);
+	}
+
+	return _own_pool;
+}
+
+void effect::set_threads(unsigned int n){
+	if ( n == _threads ){
+		return;
+	}
+
+	_threads = n;
+	delete _own_pool;
+	_own_pool = NULL;
+}
+
+void effect::set_thread_pool(thread_pool* pool){
+	_pool = pool;
+}
+
+void effect::index_dependants(){
+	_dependants.clear();
 
 	for ( iterator it = technique_begin(); it != technique_end(); ++it ){
 		technique* tech = it->second;
-		if ( ( ret = tech->compile(log) ) != 0 ){
-			return ret;
+		for ( technique::iterator p = tech->pass_begin(); p != tech->pass_end(); ++p ){
+			pass* pass = *p;
+			for ( pass::const_iterator s = pass->_shader.begin(); s != pass->_shader.end(); ++s ){
+				const std::vector<pass::dependency>& deps = s->second.deps;
+				for ( std::vector<pass::dependency>::const_iterator d = deps.begin(); d != deps.end(); ++d ){
+					std::vector<glslfx::pass*>& dst = _dependants[d->path];
+
+					/* a file may be used by several stages of the same pass */
+					if ( std::find(dst.begin(), dst.end(), pass) == dst.end() ){
+						dst.push_back(pass);
+					}
+				}
+			}
 		}
 	}
+}
+
+int effect::dependants(const std::string& path, std::vector<pass*>& dst) const {
+	dependant_map::const_iterator it = _dependants.find(path);
+
+	if ( it == _dependants.end() ){
+		return E_NOT_FOUND;
+	}
 
+	dst = it->second;
 	return 0;
 }
 
@@ -93,16 +276,85 @@ const std::string& effect::dirref() const {
 }
 
 std::string effect::resolve_path(const std::string& in) const {
-	return _dirref + "/" + in;
+	return _resolver->resolve(in);
+}
+
+void effect::add_include_path(const std::string& dir){
+	_resolver->add_search_path(dir);
+}
+
+void effect::clear_include_paths(){
+	_resolver->clear_search_paths();
+}
+
+const std::vector<std::string>& effect::include_paths() const {
+	return _resolver->search_paths();
+}
+
+int effect::path_store(const std::string& path, unsigned int& handle) const {
+	return _file_table->store(path, handle);
+}
+
+int effect::path_retrieve(unsigned int handle, std::string& path) const {
+	const std::string* tmp = _file_table->retrieve(handle);
+
+	if ( !tmp ){
+		return E_NOT_FOUND;
+	}
+
+	path = *tmp;
+	return 0;
+}
+
+const file_provider* effect::files() const {
+	return _files;
+}
+
+void effect::set_file_provider(const file_provider* files){
+	_files = files;
+	_resolver->set_provider(files);
+}
+
+include_cache* effect::includes() const {
+	return _includes;
+}
+
+void effect::set_include_cache(include_cache* cache){
+	_includes = cache ? cache : &_own_includes;
+}
+
+shader_cache* effect::shaders() const {
+	return _shaders;
+}
+
+void effect::set_shader_cache(shader_cache* cache){
+	_shaders = cache ? cache : &_own_shaders;
 }
 
 technique* effect::technique_get(const std::string& name) {
-	iterator it = _techniques.find(name);
-	if ( it == _techniques.end() ){
+	technique_id id;
+
+	if ( _technique_index->find(name, id) != 0 ){
 		return NULL;
 	}
 
-	return it->second;
+	return _technique_table[id];
+}
+
+int effect::technique_find(const string_view& name, technique_id& dst) const {
+	return _technique_index->find(name, dst);
+}
+
+technique* effect::technique_at(technique_id id) const {
+	if ( id >= _technique_table.size() ){
+		return NULL;
+	}
+
+	return _technique_table[id];
+}
+
+size_t effect::technique_count() const {
+	return _technique_table.size();
 }
 
 effect::const_iterator effect::technique_begin() const {
@@ -122,8 +374,16 @@ effect::iterator effect::technique_end(){
 }
 
 technique* effect::technique_new(const std::string& name){
+	/* a technique declared again continues the first one */
+	iterator it = _techniques.find(name);
+	if ( it != _techniques.end() ){
+		return it->second;
+	}
+
 	technique* tmp = new technique(this, name);
 	_techniques.insert(pair(name, tmp));
+	_technique_index->insert(name, (technique_id)_technique_table.size());
+	_technique_table.push_back(tmp);
 	return tmp;
 }
 
@@ -0,0 +1,232 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "glslfx/effect_library.h"
+#include "glslfx/glslfx.h"
+#include "glslfx/thread_pool.h"
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+#include <dirent.h>
+
+/**
+ * A single fx-file to parse.
+ */
+typedef struct {
+	std::string filename;
+	effect* ep;
+	int ret;
+} library_job;
+
+typedef struct {
+	library_job* jobs;
+	include_cache* includes;
+	const file_provider* files;
+	thread_pool* pool;
+} library_batch;
+
+effect_library::effect_library()
+	: _files(NULL)
+	, _threads(0)
+	, _pool(NULL) {
+
+}
+
+effect_library::~effect_library(){
+	for ( iterator it = _effects.begin(); it != _effects.end(); ++it ){
+		delete *it;
+	}
+
+	delete _pool;
+}
+
+void effect_library::add(const std::string& filename){
+	_pending.push_back(filename);
+}
+
+int effect_library::add_directory(const std::string& path){
+	static const char ext[] = ".glslfx";
+	static const size_t ext_len = sizeof(ext) - 1;
+	std::vector<std::string> found;
+	struct dirent* ent;
+	DIR* dir;
+
+	if ( ( dir = opendir(path.c_str()) ) == NULL ){
+		return errno;
+	}
+
+	while ( ( ent = readdir(dir) ) != NULL ){
+		const size_t len = strlen(ent->d_name);
+		if ( len > ext_len && strcmp(ent->d_name + len - ext_len, ext) == 0 ){
+			found.push_back(path + "/" + ent->d_name);
+		}
+	}
+
+	closedir(dir);
+
+	/* directory order depends on the filesystem */
+	std::sort(found.begin(), found.end());
+	_pending.insert(_pending.end(), found.begin(), found.end());
+
+	return 0;
+}
+
+void effect_library::load_job(void* data, size_t index){
+	library_batch* b = (library_batch*)data;
+	library_job* cur = &b->jobs[index];
+
+	cur->ep = new effect(cur->filename);
+	cur->ep->set_include_cache(b->includes);
+	cur->ep->set_file_provider(b->files);
+	cur->ep->set_thread_pool(b->pool);
+
+	if ( ( cur->ret = cur->ep->parse() ) != 0 ){
+		delete cur->ep;
+		cur->ep = NULL;
+	}
+}
+
+int effect_library::load(log_sink* log){
+	std::vector<library_job> jobs;
+	int ret = 0;
+
+	/* skip files which are loaded or added twice */
+	for ( std::vector<std::string>::const_iterator it = _pending.begin(); it != _pending.end(); ++it ){
+		if ( _names.find(*it) != _names.end() ){
+			continue;
+		}
+
+		library_job tmp;
+		tmp.filename = *it;
+		tmp.ep = NULL;
+		tmp.ret = 0;
+
+		_names.insert(std::pair<std::string, effect*>(*it, (effect*)NULL));
+		jobs.push_back(tmp);
+	}
+	_pending.clear();
+
+	if ( jobs.empty() ){
+		return 0;
+	}
+
+	/* parsing doesn't touch GL and each effect is independent, so all files
+	 * are parsed at once. The effects preprocess on the same pool. */
+	library_batch b = {&jobs[0], &_includes, _files, pool()};
+	b.pool->run(jobs.size(), load_job, &b);
+
+	/* keep the order the files were added in, and report failures in that
+	 * order regardless of which thread parsed them */
+	for ( std::vector<library_job>::const_iterator it = jobs.begin(); it != jobs.end(); ++it ){
+		if ( it->ep ){
+			_names[it->filename] = it->ep;
+			_effects.push_back(it->ep);
+			continue;
+		}
+
+		_names.erase(it->filename);
+
+		if ( ret == 0 ){
+			ret = it->ret;
+		}
+
+		if ( log ){
+			if ( it->ret > 0 ){
+				log->format(0, it->filename, SEVERITY_ERROR, "", "failed to read effect: %s", strerror(it->ret));
+			} else {
+				log->format(0, it->filename, SEVERITY_ERROR, "", "failed to parse effect (error %d)", it->ret);
+			}
+		}
+	}
+
+	return ret;
+}
+
+effect* effect_library::get(const std::string& filename) const {
+	map::const_iterator it = _names.find(filename);
+	if ( it == _names.end() ){
+		return NULL;
+	}
+
+	return it->second;
+}
+
+size_t effect_library::size() const {
+	return _effects.size();
+}
+
+effect_library::const_iterator effect_library::begin() const {
+	return _effects.begin();
+}
+
+effect_library::const_iterator effect_library::end() const {
+	return _effects.end();
+}
+
+effect_library::iterator effect_library::begin(){
+	return _effects.begin();
+}
+
+effect_library::iterator effect_library::end(){
+	return _effects.end();
+}
+
+include_cache* effect_library::includes(){
+	return &_includes;
+}
+
+void effect_library::set_file_provider(const file_provider* files){
+	_files = files;
+}
+
+void effect_library::set_threads(unsigned int n){
+	if ( n == _threads ){
+		return;
+	}
+
+	_threads = n;
+
+	/* loaded effects are moved to the new pool */
+	thread_pool* old = _pool;
+	_pool = NULL;
+	for ( iterator it = _effects.begin(); it != _effects.end(); ++it ){
+		(*it)->set_thread_pool(pool());
+	}
+	delete old;
+}
+
+thread_pool* effect_library::pool(){
+	if ( !_pool ){
+		_pool = new thread_pool(_threads);
+	}
+
+	return _pool;
+}
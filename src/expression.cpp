@@ -0,0 +1,543 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "expression.h"
+#include "glslfx/glslfx.h"
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#define MAX_EXPANSION_DEPTH 32
+
+typedef struct {
+	enum { NUMBER, OPERATOR, UNKNOWN } type;
+	long value;  /* NUMBER */
+	char op[3];  /* OPERATOR */
+} token;
+
+typedef std::vector<token> token_list;
+
+static const char* operators[] = {
+	"||", "&&", "==", "!=", "<=", ">=", "<<", ">>",
+	"|", "^", "&", "<", ">", "+", "-", "*", "/", "%",
+	"!", "~", "(", ")", "?", ":",
+	NULL
+};
+
+static void push_number(token_list& dst, long value){
+	token tmp;
+	tmp.type = token::NUMBER;
+	tmp.value = value;
+	tmp.op[0] = 0;
+	dst.push_back(tmp);
+}
+
+static void push_unknown(token_list& dst){
+	token tmp;
+	tmp.type = token::UNKNOWN;
+	tmp.value = 0;
+	tmp.op[0] = 0;
+	dst.push_back(tmp);
+}
+
+static void push_operator(token_list& dst, const char* op){
+	token tmp;
+	tmp.type = token::OPERATOR;
+	tmp.value = 0;
+	strncpy(tmp.op, op, sizeof(tmp.op) - 1);
+	tmp.op[sizeof(tmp.op) - 1] = 0;
+	dst.push_back(tmp);
+}
+
+static bool is_ident(char ch){
+	return isalnum((unsigned char)ch) || ch == '_';
+}
+
+bool glslfx::is_reserved_macro(const std::string& name){
+	return name.compare(0, 3, "GL_") == 0 || name.find("__") != std::string::npos;
+}
+
+/**
+ * Skip the argument list of a function-like macro invocation, if any.
+ * @return false if the list isn't terminated.
+ */
+static bool skip_arguments(const char*& p, const char* end){
+	const char* cur = p;
+	int depth = 0;
+
+	while ( cur < end && isspace((unsigned char)*cur) ) cur++;
+	if ( cur == end || *cur != '(' ){
+		return true;
+	}
+
+	for ( ; cur < end; cur++ ){
+		if ( *cur == '(' ) depth++;
+		if ( *cur == ')' && --depth == 0 ){
+			p = cur + 1;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Split an expression into tokens, replacing macros and defined().
+ * expanding holds the macros currently being replaced to stop
+ * self-referencing macros.
+ */
+static int tokenize(const char* p, const char* end,
+					const macro_map& macros,
+					unsigned int line,
+					std::set<std::string>& expanding,
+					int depth,
+					token_list& dst){
+
+	if ( depth > MAX_EXPANSION_DEPTH ){
+		return E_PARSE_ERROR;
+	}
+
+	while ( p < end ){
+		/* whitespace */
+		if ( isspace((unsigned char)*p) ){
+			p++;
+			continue;
+		}
+
+		/* comments */
+		if ( p + 1 < end && p[0] == '/' && p[1] == '/' ){
+			break;
+		}
+		if ( p + 1 < end && p[0] == '/' && p[1] == '*' ){
+			const char* close = p + 2;
+			while ( close + 1 < end && !(close[0] == '*' && close[1] == '/') ){
+				close++;
+			}
+			p = close + 2;
+			continue;
+		}
+
+		/* integer literals, strtol handles decimal, octal and hex */
+		if ( isdigit((unsigned char)*p) ){
+			char buf[64];
+			const char* sp = p;
+			while ( p < end && is_ident(*p) ){
+				p++;
+			}
+
+			size_t len = p - sp;
+			if ( len >= sizeof(buf) ){
+				return E_PARSE_ERROR;
+			}
+			memcpy(buf, sp, len);
+			buf[len] = 0;
+
+			/* strip unsigned suffix */
+			if ( len > 0 && (buf[len-1] == 'u' || buf[len-1] == 'U') ){
+				buf[--len] = 0;
+			}
+
+			char* tail;
+			long value = strtol(buf, &tail, 0);
+			if ( *tail ){
+				return E_PARSE_ERROR;
+			}
+
+			push_number(dst, value);
+			continue;
+		}
+
+		/* identifiers */
+		if ( isalpha((unsigned char)*p) || *p == '_' ){
+			const char* sp = p;
+			while ( p < end && is_ident(*p) ){
+				p++;
+			}
+			std::string name(sp, p - sp);
+
+			/* defined X or defined(X) */
+			if ( name == "defined" ){
+				bool paren = false;
+
+				while ( p < end && isspace((unsigned char)*p) ) p++;
+				if ( p < end && *p == '(' ){
+					paren = true;
+					p++;
+					while ( p < end && isspace((unsigned char)*p) ) p++;
+				}
+
+				sp = p;
+				while ( p < end && is_ident(*p) ){
+					p++;
+				}
+				if ( p == sp ){
+					return E_PARSE_ERROR;
+				}
+				std::string ident(sp, p - sp);
+
+				if ( paren ){
+					while ( p < end && isspace((unsigned char)*p) ) p++;
+					if ( p == end || *p != ')' ){
+						return E_PARSE_ERROR;
+					}
+					p++;
+				}
+
+				macro_map::const_iterator it = macros.find(ident);
+				if ( ident == "__LINE__" ){
+					push_number(dst, 1);
+				} else if ( it != macros.end() ){
+					if ( it->second.uncertain ){
+						push_unknown(dst);
+					} else {
+						push_number(dst, 1);
+					}
+				} else if ( is_reserved_macro(ident) ){
+					push_unknown(dst);
+				} else {
+					push_number(dst, 0);
+				}
+				continue;
+			}
+
+			macro_map::const_iterator it = macros.find(name);
+
+			/* the line of the directive in its own file */
+			if ( it == macros.end() && name == "__LINE__" ){
+				push_number(dst, line);
+				continue;
+			}
+
+			/* macros the driver might define are evaluated by the driver */
+			if ( it == macros.end() ){
+				if ( is_reserved_macro(name) ){
+					push_unknown(dst);
+				} else {
+					push_number(dst, 0);
+				}
+				continue;
+			}
+
+			/* function-like macros aren't expanded here, the invocation as a
+			 * whole is left to the driver */
+			if ( it->second.function ){
+				if ( !skip_arguments(p, end) ){
+					return E_PARSE_ERROR;
+				}
+				push_unknown(dst);
+				continue;
+			}
+
+			if ( it->second.uncertain ){
+				push_unknown(dst);
+				continue;
+			}
+
+			/* self-referencing macros are not replaced again */
+			if ( expanding.count(name) > 0 ){
+				push_number(dst, 0);
+				continue;
+			}
+
+			/* replace with definition */
+			const std::string& value = it->second.value;
+			int ret;
+			expanding.insert(name);
+			ret = tokenize(value.data(), value.data() + value.size(), macros, line, expanding, depth + 1, dst);
+			expanding.erase(name);
+			if ( ret != 0 ){
+				return ret;
+			}
+			continue;
+		}
+
+		/* operators, longest match first */
+		const char** op;
+		for ( op = operators; *op; op++ ){
+			size_t len = strlen(*op);
+			if ( (size_t)(end - p) >= len && strncmp(p, *op, len) == 0 ){
+				push_operator(dst, *op);
+				p += len;
+				break;
+			}
+		}
+
+		if ( !*op ){
+			return E_PARSE_ERROR;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Value of an operand, unknown if it depends on the driver.
+ */
+typedef struct {
+	long n;
+	bool known;
+} value;
+
+static value make_value(long n, bool known = true){
+	value tmp = {n, known};
+	return tmp;
+}
+
+/**
+ * Recursive descent evaluator over a token list.
+ */
+class evaluator {
+public:
+	evaluator(const token_list& tokens)
+		: _tokens(tokens)
+		, _pos(0)
+		, _skip(0)
+		, _error(false) {
+
+	}
+
+	bool run(value& result){
+		result = conditional();
+		return !_error && _pos == _tokens.size();
+	}
+
+private:
+	bool accept(const char* op){
+		if ( _pos < _tokens.size() && _tokens[_pos].type == token::OPERATOR && strcmp(_tokens[_pos].op, op) == 0 ){
+			_pos++;
+			return true;
+		}
+		return false;
+	}
+
+	static int precedence(const char* op){
+		static const struct { const char* op; int prec; } table[] = {
+			{"||", 1}, {"&&", 2}, {"|", 3}, {"^", 4}, {"&", 5},
+			{"==", 6}, {"!=", 6},
+			{"<", 7}, {">", 7}, {"<=", 7}, {">=", 7},
+			{"<<", 8}, {">>", 8},
+			{"+", 9}, {"-", 9},
+			{"*", 10}, {"/", 10}, {"%", 10},
+			{NULL, 0}
+		};
+
+		for ( int i = 0; table[i].op; i++ ){
+			if ( strcmp(table[i].op, op) == 0 ){
+				return table[i].prec;
+			}
+		}
+
+		return 0;
+	}
+
+	value conditional(){
+		value cond = binary(1);
+
+		if ( accept("?") ){
+			value a, b;
+
+			/* only the selected operand is evaluated, with an unknown
+			 * condition either might be */
+			const bool skip_a = cond.known && !cond.n;
+			const bool skip_b = cond.known && cond.n;
+
+			if ( skip_a ) _skip++;
+			a = conditional();
+			if ( skip_a ) _skip--;
+
+			if ( !accept(":") ){
+				_error = true;
+				return make_value(0);
+			}
+
+			if ( skip_b ) _skip++;
+			b = conditional();
+			if ( skip_b ) _skip--;
+
+			if ( !cond.known ){
+				return make_value(0, false);
+			}
+			return cond.n ? a : b;
+		}
+
+		return cond;
+	}
+
+	value binary(int min_prec){
+		value lhs = unary();
+
+		while ( !_error && _pos < _tokens.size() && _tokens[_pos].type == token::OPERATOR ){
+			const char* op = _tokens[_pos].op;
+			int prec = precedence(op);
+			if ( prec == 0 || prec < min_prec ){
+				break;
+			}
+
+			_pos++;
+
+			/* short-circuit, the right operand is parsed but not evaluated */
+			const bool is_and = strcmp(op, "&&") == 0;
+			const bool is_or = strcmp(op, "||") == 0;
+			const bool skip = lhs.known && ( ( is_and && !lhs.n ) || ( is_or && lhs.n ) );
+			if ( skip ) _skip++;
+			value rhs = binary(prec + 1);
+			if ( skip ) _skip--;
+
+			if ( skip ){
+				lhs = make_value(is_or);
+			} else if ( ( is_and || is_or ) && rhs.known && ( is_and ? !rhs.n : rhs.n ) ){
+				/* decided by the right operand alone */
+				lhs = make_value(is_or);
+			} else if ( !lhs.known || !rhs.known ){
+				lhs = make_value(0, false);
+			} else {
+				lhs = make_value(apply(op, lhs.n, rhs.n));
+			}
+		}
+
+		return lhs;
+	}
+
+	/**
+	 * Division by zero and shifts out of range are only errors if the
+	 * operand is actually evaluated.
+	 */
+	long range_error(){
+		_error = _error || _skip == 0;
+		return 0;
+	}
+
+	/* arithmetic which wraps on overflow */
+	static long wrap(unsigned long n){
+		return (long)n;
+	}
+
+	long apply(const char* op, long a, long b){
+		static const long bits = sizeof(long) * CHAR_BIT;
+
+		switch ( op[0] ){
+			case '|': return op[1] == '|' ? (a || b) : (a | b);
+			case '&': return op[1] == '&' ? (a && b) : (a & b);
+			case '^': return a ^ b;
+			case '=': return a == b;
+			case '!': return a != b;
+			case '<':
+				if ( op[1] == '<' ) return b < 0 || b >= bits ? range_error() : wrap((unsigned long)a << b);
+				if ( op[1] == '=' ) return a <= b;
+				return a < b;
+			case '>':
+				if ( op[1] == '>' ) return b < 0 || b >= bits ? range_error() : a >> b;
+				if ( op[1] == '=' ) return a >= b;
+				return a > b;
+			case '+': return wrap((unsigned long)a + (unsigned long)b);
+			case '-': return wrap((unsigned long)a - (unsigned long)b);
+			case '*': return wrap((unsigned long)a * (unsigned long)b);
+			case '/':
+			case '%':
+				if ( b == 0 ){
+					return range_error();
+				}
+				/* LONG_MIN / -1 overflows */
+				if ( b == -1 ){
+					return op[0] == '/' ? wrap(0 - (unsigned long)a) : 0;
+				}
+				return op[0] == '/' ? a / b : a % b;
+		}
+
+		_error = true;
+		return 0;
+	}
+
+	value unary(){
+		value tmp;
+
+		if ( _pos >= _tokens.size() ){
+			_error = true;
+			return make_value(0);
+		}
+
+		if ( _tokens[_pos].type == token::NUMBER ){
+			return make_value(_tokens[_pos++].value);
+		}
+
+		if ( _tokens[_pos].type == token::UNKNOWN ){
+			_pos++;
+			return make_value(0, false);
+		}
+
+		if ( accept("(") ){
+			tmp = conditional();
+			if ( !accept(")") ){
+				_error = true;
+			}
+			return tmp;
+		}
+
+		if ( accept("+") ) return unary();
+		if ( accept("-") ){ tmp = unary(); tmp.n = wrap(0 - (unsigned long)tmp.n); return tmp; }
+		if ( accept("~") ){ tmp = unary(); tmp.n = ~tmp.n; return tmp; }
+		if ( accept("!") ){ tmp = unary(); tmp.n = !tmp.n; return tmp; }
+
+		_error = true;
+		return make_value(0);
+	}
+
+	const token_list& _tokens;
+	size_t _pos;
+	int _skip;   /* inside an unevaluated operand */
+	bool _error;
+};
+
+int glslfx::eval_expression(const char* begin, const char* end, const macro_map& macros, unsigned int line, long& result){
+	token_list tokens;
+	std::set<std::string> expanding;
+	value tmp;
+	int ret;
+
+	if ( ( ret = tokenize(begin, end, macros, line, expanding, 0, tokens) ) != 0 ){
+		return ret;
+	}
+
+	evaluator eval(tokens);
+	if ( !eval.run(tmp) ){
+		return E_PARSE_ERROR;
+	}
+
+	if ( !tmp.known ){
+		return EXPR_DEFERRED;
+	}
+
+	result = tmp.n;
+	return 0;
+}
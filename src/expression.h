@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GLSL_FX_EXPRESSION_H
+#define __GLSL_FX_EXPRESSION_H
+
+#include <string>
+#include <map>
+
+namespace glslfx {
+
+	/**
+	 * Preprocessor macro.
+	 */
+	typedef struct {
+		std::string value; /* replacement text */
+		bool function;     /* function-like macro */
+		bool uncertain;    /* defined or undefined in a region only the driver
+		                    * can decide, its state is unknown */
+	} macro;
+
+	typedef std::map<std::string, macro> macro_map;
+
+	enum {
+		/* the value depends on macros only the driver knows */
+		EXPR_DEFERRED = 1
+	};
+
+	/**
+	 * Tell if a name is reserved for macros predefined by the driver (eg.
+	 * GL_ES, GL_ARB_gpu_shader5 or __FILE__). Shaders cannot define such
+	 * names, so if one isn't known it may still be defined by the driver.
+	 */
+	bool is_reserved_macro(const std::string& name);
+
+	/**
+	 * Evaluate a preprocessor #if expression. Identifiers are replaced by
+	 * their macro definitions and undefined identifiers evaluate to 0,
+	 * except reserved names (see is_reserved_macro), uncertain macros and
+	 * function-like macros which are left for the driver to evaluate. They
+	 * only defer the result if they are evaluated, eg. not in the right
+	 * operand of a false &&.
+	 * @param begin Start of expression.
+	 * @param end End of expression.
+	 * @param macros Macros currently defined.
+	 * @param line Line of the directive, the value of __LINE__.
+	 * @param result Output
+	 * @return 0 if successful, EXPR_DEFERRED if the driver has to evaluate
+	 *         the expression or E_PARSE_ERROR.
+	 */
+	int eval_expression(const char* begin, const char* end, const macro_map& macros, unsigned int line, long& result);
+
+}
+
+#endif /* __GLSL_FX_EXPRESSION_H */
@@ -0,0 +1,381 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "glslfx/file_provider.h"
+#include "glslfx/glslfx.h"
+#include "mapped_file.h"
+#include "path_resolver.h"
+#include "hash.h"
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <stdint.h>
+#include <algorithm>
+
+/**
+ * Layout of an archive: a header, the directory sorted by the hash of the
+ * path (and the path itself for equal hashes), a blob with all paths and
+ * last the file contents, each at a 16-byte aligned offset. Offsets are
+ * relative to the start of the file and integers are stored in host byte
+ * order.
+ */
+static const char archive_magic[8] = {'G', 'L', 'S', 'L', 'F', 'X', 'A', '\0'};
+static const uint32_t archive_version = 1;
+static const uint32_t archive_endian = 0x01020304;
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t endian;
+	uint64_t size;         /* size of the entire file */
+	uint64_t count;        /* number of directory entries */
+	uint64_t dir_offset;
+	uint64_t names_offset;
+	uint64_t names_size;
+} archive_header;
+
+struct glslfx::archive_entry {
+	uint64_t hash;         /* hash of the path */
+	uint64_t name_offset;  /* offset in the name blob */
+	uint64_t name_size;
+	uint64_t offset;       /* offset of the contents */
+	uint64_t size;
+};
+
+static size_t align16(size_t offset){
+	return (offset + 15) & ~(size_t)15;
+}
+
+static bool entry_less(const archive_entry& a, const string_view& a_name, const archive_entry& b, const string_view& b_name){
+	if ( a.hash != b.hash ){
+		return a.hash < b.hash;
+	}
+
+	const int cmp = memcmp(a_name.data(), b_name.data(), std::min(a_name.size(), b_name.size()));
+	return cmp < 0 || ( cmp == 0 && a_name.size() < b_name.size() );
+}
+
+file_provider::~file_provider(){
+
+}
+
+int filesystem_provider::open(const std::string& path, file& dst) const {
+	mapped_file* tmp = new mapped_file;
+	int ret;
+
+	if ( ( ret = tmp->open(path) ) != 0 ){
+		delete tmp;
+		return ret;
+	}
+
+	dst.data = tmp->data();
+	dst.size = tmp->size();
+	dst.id = tmp->id();
+	dst.handle = tmp;
+	return 0;
+}
+
+void filesystem_provider::close(file& src) const {
+	delete (mapped_file*)src.handle;
+	src.data = NULL;
+	src.size = 0;
+	src.handle = NULL;
+}
+
+int filesystem_provider::stat(const std::string& path, include_cache::identity& dst) const {
+	return include_cache::stat(path, dst);
+}
+
+archive_provider::archive_provider()
+	: _archive(NULL)
+	, _names(NULL)
+	, _dir(NULL)
+	, _size(0) {
+
+	memset(&_id, 0, sizeof(_id));
+}
+
+archive_provider::~archive_provider(){
+	delete _archive;
+}
+
+int archive_provider::load(const std::string& path){
+	mapped_file* tmp = new mapped_file;
+	int ret;
+
+	if ( ( ret = tmp->open(path) ) != 0 ){
+		delete tmp;
+		return ret;
+	}
+
+	const char* data = tmp->data();
+	const size_t size = tmp->size();
+	const archive_header* header = (const archive_header*)data;
+
+	/* the header and directory must be within the file */
+	if ( size < sizeof(archive_header) ||
+		 memcmp(header->magic, archive_magic, sizeof(header->magic)) != 0 ||
+		 header->version != archive_version ||
+		 header->endian != archive_endian ||
+		 header->size != size ||
+		 header->dir_offset % 16 != 0 || header->dir_offset > size ||
+		 header->count > (size - header->dir_offset) / sizeof(archive_entry) ||
+		 header->names_offset > size || header->names_size > size - header->names_offset ){
+		delete tmp;
+		return E_PARSE_ERROR;
+	}
+
+	const archive_entry* dir = (const archive_entry*)(data + header->dir_offset);
+	const char* names = data + header->names_offset;
+
+	/* all names and contents must be within the file and the directory
+	 * sorted, so lookups need no further checks */
+	for ( uint64_t i = 0; i < header->count; i++ ){
+		const archive_entry& cur = dir[i];
+		if ( cur.name_offset > header->names_size || cur.name_size > header->names_size - cur.name_offset ||
+			 cur.offset > size || cur.size > size - cur.offset ){
+			delete tmp;
+			return E_PARSE_ERROR;
+		}
+
+		if ( i > 0 ){
+			const archive_entry& prev = dir[i - 1];
+			if ( !entry_less(prev, string_view(names + prev.name_offset, prev.name_size),
+							 cur, string_view(names + cur.name_offset, cur.name_size)) ){
+				delete tmp;
+				return E_PARSE_ERROR;
+			}
+		}
+	}
+
+	delete _archive;
+	_archive = tmp;
+	include_cache::stat(tmp->info(), _id);
+	_names = names;
+	_dir = dir;
+	_size = header->count;
+	return 0;
+}
+
+size_t archive_provider::size() const {
+	return _size;
+}
+
+const archive_entry* archive_provider::find(const std::string& path) const {
+	const std::string name = path_resolver::canonicalize(path);
+	archive_entry key;
+
+	key.hash = glslfx::hash(name.data(), name.size());
+
+	/* binary search for the first entry with the hash */
+	size_t lo = 0;
+	size_t hi = _size;
+	while ( lo < hi ){
+		const size_t mid = (lo + hi) / 2;
+		if ( _dir[mid].hash < key.hash ){
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	for ( ; lo < _size && _dir[lo].hash == key.hash; lo++ ){
+		const archive_entry& cur = _dir[lo];
+		if ( string_view(_names + cur.name_offset, cur.name_size) == name ){
+			return &cur;
+		}
+	}
+
+	return NULL;
+}
+
+int archive_provider::open(const std::string& path, file& dst) const {
+	const archive_entry* entry = find(path);
+
+	if ( !entry ){
+		return ENOENT;
+	}
+
+	dst.data = _archive->data() + entry->offset;
+	dst.size = entry->size;
+	dst.id = _id;
+	dst.id.size = entry->size;
+	dst.handle = NULL;
+	return 0;
+}
+
+void archive_provider::close(file& src) const {
+	/* contents belong to the mapping */
+	src.data = NULL;
+	src.size = 0;
+}
+
+int archive_provider::stat(const std::string& path, include_cache::identity& dst) const {
+	const archive_entry* entry = find(path);
+
+	if ( !entry ){
+		return ENOENT;
+	}
+
+	dst = _id;
+	dst.size = entry->size;
+	return 0;
+}
+
+/**
+ * A file while an archive is written.
+ */
+typedef struct {
+	archive_entry entry;
+	std::string name;
+	std::string path;
+} packed;
+
+static bool packed_less(const packed& a, const packed& b){
+	return entry_less(a.entry, a.name, b.entry, b.name);
+}
+
+static int write_padded(FILE* fp, const void* data, size_t size, size_t offset, size_t& pos){
+	static const char zero[16] = {0};
+
+	while ( pos < offset ){
+		const size_t n = std::min(offset - pos, sizeof(zero));
+		if ( fwrite(zero, 1, n, fp) != n ){
+			return errno ? errno : EIO;
+		}
+		pos += n;
+	}
+
+	if ( size > 0 && fwrite(data, 1, size, fp) != size ){
+		return errno ? errno : EIO;
+	}
+
+	pos += size;
+	return 0;
+}
+
+int archive_provider::pack(const std::string& dst, const std::vector<std::string>& files){
+	std::vector<packed> entries;
+	std::string names;
+	archive_header header;
+	int ret = 0;
+
+	for ( std::vector<std::string>::const_iterator it = files.begin(); it != files.end(); ++it ){
+		packed tmp;
+		tmp.path = *it;
+		tmp.name = path_resolver::canonicalize(*it);
+		tmp.entry.hash = glslfx::hash(tmp.name.data(), tmp.name.size());
+		entries.push_back(tmp);
+	}
+
+	std::sort(entries.begin(), entries.end(), packed_less);
+
+	/* remove duplicates */
+	std::vector<packed> unique;
+	for ( std::vector<packed>::iterator it = entries.begin(); it != entries.end(); ++it ){
+		if ( unique.empty() || unique.back().name != it->name ){
+			unique.push_back(*it);
+		}
+	}
+
+	/* directory, names and then the contents */
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, archive_magic, sizeof(header.magic));
+	header.version = archive_version;
+	header.endian = archive_endian;
+	header.count = unique.size();
+	header.dir_offset = align16(sizeof(archive_header));
+	header.names_offset = header.dir_offset + unique.size() * sizeof(archive_entry);
+
+	for ( std::vector<packed>::iterator it = unique.begin(); it != unique.end(); ++it ){
+		it->entry.name_offset = names.size();
+		it->entry.name_size = it->name.size();
+		names += it->name;
+	}
+	header.names_size = names.size();
+
+	size_t offset = header.names_offset + names.size();
+	std::vector<mapped_file*> contents;
+	for ( std::vector<packed>::iterator it = unique.begin(); it != unique.end(); ++it ){
+		mapped_file* tmp = new mapped_file;
+		contents.push_back(tmp);
+
+		if ( ( ret = tmp->open(it->path) ) != 0 ){
+			break;
+		}
+
+		offset = align16(offset);
+		it->entry.offset = offset;
+		it->entry.size = tmp->size();
+		offset += tmp->size();
+	}
+	header.size = offset;
+
+	/* written to a temporary file so readers never see a partial file */
+	const std::string tmp = dst + ".tmp";
+	FILE* fp = NULL;
+	if ( ret == 0 && !( fp = fopen(tmp.c_str(), "wb") ) ){
+		ret = errno;
+	}
+
+	if ( fp ){
+		size_t pos = 0;
+
+		ret = write_padded(fp, &header, sizeof(header), 0, pos);
+		for ( size_t i = 0; ret == 0 && i < unique.size(); i++ ){
+			ret = write_padded(fp, &unique[i].entry, sizeof(archive_entry), header.dir_offset + i * sizeof(archive_entry), pos);
+		}
+		if ( ret == 0 ){
+			ret = write_padded(fp, names.data(), names.size(), header.names_offset, pos);
+		}
+		for ( size_t i = 0; ret == 0 && i < unique.size(); i++ ){
+			ret = write_padded(fp, contents[i]->data(), contents[i]->size(), unique[i].entry.offset, pos);
+		}
+
+		if ( fclose(fp) != 0 && ret == 0 ){
+			ret = errno;
+		}
+
+		if ( ret == 0 && rename(tmp.c_str(), dst.c_str()) != 0 ){
+			ret = errno;
+		}
+
+		if ( ret != 0 ){
+			remove(tmp.c_str());
+		}
+	}
+
+	for ( std::vector<mapped_file*>::iterator it = contents.begin(); it != contents.end(); ++it ){
+		delete *it;
+	}
+
+	return ret;
+}
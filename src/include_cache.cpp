@@ -0,0 +1,186 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "glslfx/include_cache.h"
+#include "glslfx/glslfx.h"
+#include "glslfx/file_provider.h"
+#include "mapped_file.h"
+#include <sys/stat.h>
+#include <errno.h>
+
+include_cache::include_cache()
+	: _scopes(0)
+	, _hits(0)
+	, _misses(0) {
+
+	pthread_mutex_init(&_lock, NULL);
+}
+
+static void free_entry(include_cache::entry* entry){
+	delete entry->file;
+	delete entry;
+}
+
+include_cache::~include_cache(){
+	clear();
+	pthread_mutex_destroy(&_lock);
+}
+
+const include_cache::entry* include_cache::find(const std::string& path, const file_provider* files){
+	/* stat without holding the lock, it is only used if there is an entry */
+	identity cur;
+	int status = files ? files->stat(path, cur) : stat(path, cur);
+
+	pthread_mutex_lock(&_lock);
+	iterator it = _entries.find(path);
+
+	if ( it == _entries.end() ){
+		_misses++;
+		pthread_mutex_unlock(&_lock);
+		return NULL;
+	}
+
+	/* ensure the file hasn't changed */
+	if ( status != 0 || !same(cur, it->second->id) ){
+		retire(it);
+		_misses++;
+		pthread_mutex_unlock(&_lock);
+		return NULL;
+	}
+
+	entry* found = it->second;
+	_hits++;
+	pthread_mutex_unlock(&_lock);
+	return found;
+}
+
+const include_cache::entry* include_cache::store(const std::string& path, entry* src){
+	pthread_mutex_lock(&_lock);
+
+	/* another thread may have stored the same file meanwhile, the older
+	 * entry is retired as it may already be in use */
+	iterator it = _entries.find(path);
+	if ( it != _entries.end() ){
+		retire(it);
+	}
+
+	_entries.insert(pair(path, src));
+	pthread_mutex_unlock(&_lock);
+	return src;
+}
+
+void include_cache::retire(iterator it){
+	_retired.push_back(it->second);
+	_entries.erase(it);
+}
+
+include_cache::scope::scope(include_cache* cache)
+	: _cache(cache) {
+
+	pthread_mutex_lock(&_cache->_lock);
+	_cache->_scopes++;
+	pthread_mutex_unlock(&_cache->_lock);
+}
+
+include_cache::scope::~scope(){
+	pthread_mutex_lock(&_cache->_lock);
+
+	/* no source can point into a replaced entry anymore */
+	if ( --_cache->_scopes == 0 ){
+		for ( std::vector<entry*>::iterator it = _cache->_retired.begin(); it != _cache->_retired.end(); ++it ){
+			free_entry(*it);
+		}
+		_cache->_retired.clear();
+	}
+
+	pthread_mutex_unlock(&_cache->_lock);
+}
+
+size_t include_cache::retired() const {
+	return _retired.size();
+}
+
+void include_cache::clear(){
+	pthread_mutex_lock(&_lock);
+
+	for ( iterator it = _entries.begin(); it != _entries.end(); ++it ){
+		free_entry(it->second);
+	}
+
+	for ( std::vector<entry*>::iterator it = _retired.begin(); it != _retired.end(); ++it ){
+		free_entry(*it);
+	}
+
+	_entries.clear();
+	_retired.clear();
+
+	pthread_mutex_unlock(&_lock);
+}
+
+unsigned int include_cache::hits() const {
+	return _hits;
+}
+
+unsigned int include_cache::misses() const {
+	return _misses;
+}
+
+int include_cache::stat(const std::string& path, identity& dst){
+	struct stat st;
+
+	if ( ::stat(path.c_str(), &st) != 0 ){
+		return errno;
+	}
+
+	stat(st, dst);
+	return 0;
+}
+
+void include_cache::stat(const struct stat& st, identity& dst){
+	dst.dev = st.st_dev;
+	dst.ino = st.st_ino;
+	dst.mtime = st.st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+	dst.mtime_nsec = st.st_mtim.tv_nsec;
+#else
+	dst.mtime_nsec = 0;
+#endif /* HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC */
+	dst.size = st.st_size;
+}
+
+bool include_cache::same(const identity& a, const identity& b){
+	return
+		a.dev        == b.dev &&
+		a.ino        == b.ino &&
+		a.mtime      == b.mtime &&
+		a.mtime_nsec == b.mtime_nsec &&
+		a.size       == b.size;
+}
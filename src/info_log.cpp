@@ -0,0 +1,187 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "info_log.h"
+#include <cctype>
+#include <cstring>
+
+/* Each scanner consumes the line from the left and fails as soon as the
+ * line deviates from the format, nothing is copied. */
+
+/**
+ * Consume a literal.
+ */
+static bool expect(const char*& p, const char* end, const char* str){
+	const size_t len = strlen(str);
+	if ( (size_t)(end - p) < len || memcmp(p, str, len) != 0 ){
+		return false;
+	}
+
+	p += len;
+	return true;
+}
+
+/**
+ * Consume a decimal number.
+ */
+static bool number(const char*& p, const char* end, unsigned int& dst){
+	if ( p == end || !isdigit((unsigned char)*p) ){
+		return false;
+	}
+
+	dst = 0;
+	while ( p < end && isdigit((unsigned char)*p) ){
+		dst = dst * 10 + (*p++ - '0');
+	}
+
+	return true;
+}
+
+/**
+ * Consume a non-empty run of characters accepted by pred.
+ */
+static bool token(const char*& p, const char* end, int (*pred)(int), const char*& dst, size_t& len){
+	const char* sp = p;
+	while ( p < end && pred((unsigned char)*p) ){
+		p++;
+	}
+
+	dst = sp;
+	len = p - sp;
+	return len > 0;
+}
+
+static int is_ref(int c){
+	return isalnum((unsigned char)c) || c == '#';
+}
+
+/**
+ * The rest of the line is the message, it must not be empty.
+ */
+static bool rest(const char* p, const char* end, info_message& dst){
+	dst.message = p;
+	dst.message_len = end - p;
+	return p < end;
+}
+
+/**
+ * ATI: "ERROR: 0:19: error(#160) Cannot convert from ..."
+ */
+static bool parse_ati(const char* p, const char* end, info_message& dst){
+	const char* tag;
+	size_t tag_len;
+
+	return token(p, end, isupper, tag, tag_len)
+		&& expect(p, end, ": ")
+		&& number(p, end, dst.string)
+		&& expect(p, end, ":")
+		&& number(p, end, dst.line)
+		&& expect(p, end, ": ")
+		&& token(p, end, isalpha, dst.severity, dst.severity_len)
+		&& expect(p, end, "(")
+		&& token(p, end, is_ref, dst.ref, dst.ref_len)
+		&& expect(p, end, ") ")
+		&& rest(p, end, dst);
+}
+
+/**
+ * NVIDIA: "0(5) : warning C7533: global variable ..."
+ */
+static bool parse_nvidia(const char* p, const char* end, info_message& dst){
+	return number(p, end, dst.string)
+		&& expect(p, end, "(")
+		&& number(p, end, dst.line)
+		&& expect(p, end, ") : ")
+		&& token(p, end, isalpha, dst.severity, dst.severity_len)
+		&& expect(p, end, " ")
+		&& token(p, end, isalnum, dst.ref, dst.ref_len)
+		&& expect(p, end, ": ")
+		&& rest(p, end, dst);
+}
+
+/**
+ * Mesa: "0:12(5): error: `foo' undeclared"
+ */
+static bool parse_mesa(const char* p, const char* end, info_message& dst){
+	unsigned int column;
+
+	dst.ref = p;
+	dst.ref_len = 0;
+
+	return number(p, end, dst.string)
+		&& expect(p, end, ":")
+		&& number(p, end, dst.line)
+		&& expect(p, end, "(")
+		&& number(p, end, column)
+		&& expect(p, end, "): ")
+		&& token(p, end, isalpha, dst.severity, dst.severity_len)
+		&& expect(p, end, ": ")
+		&& rest(p, end, dst);
+}
+
+/**
+ * Generic (3Dlabs derived compilers): "ERROR: 0:12: 'foo' : undeclared identifier"
+ */
+static bool parse_generic(const char* p, const char* end, info_message& dst){
+	dst.ref = p;
+	dst.ref_len = 0;
+
+	return token(p, end, isupper, dst.severity, dst.severity_len)
+		&& expect(p, end, ": ")
+		&& number(p, end, dst.string)
+		&& expect(p, end, ":")
+		&& number(p, end, dst.line)
+		&& expect(p, end, ": ")
+		&& rest(p, end, dst);
+}
+
+static bool parse_ati_or_generic(const char* p, const char* end, info_message& dst){
+	return parse_ati(p, end, dst) || parse_generic(p, end, dst);
+}
+
+static bool parse_other(const char* p, const char* end, info_message& dst){
+	return parse_mesa(p, end, dst) || parse_ati(p, end, dst) || parse_generic(p, end, dst);
+}
+
+info_parser glslfx::select_info_parser(vendor_t vendor){
+	switch ( vendor ){
+		case VENDOR_ATI:
+			return parse_ati_or_generic;
+
+		case VENDOR_NVIDIA:
+			return parse_nvidia;
+
+		case VENDOR_UNKNOWN:
+		case VENDOR_OTHER:
+			break;
+	}
+
+	return parse_other;
+}
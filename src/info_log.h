@@ -0,0 +1,66 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __GLSL_FX_INFO_LOG_H
+#define __GLSL_FX_INFO_LOG_H
+
+#include "glslfx/glslfx.h"
+#include <cstddef>
+
+namespace glslfx {
+
+	/**
+	 * A message of a driver info log. The text fields points directly into
+	 * the log buffer and are not null-terminated.
+	 */
+	typedef struct {
+		unsigned int string;     /* source string index */
+		unsigned int line;       /* line within the source string */
+		const char* severity;    /* error, warning etc */
+		size_t severity_len;
+		const char* ref;         /* vendor error code, empty if the format has none */
+		size_t ref_len;
+		const char* message;
+		size_t message_len;
+	} info_message;
+
+	/**
+	 * Parse a single line of an info log (without the newline).
+	 * @return true if the line is a message, false if the line should be
+	 *         treated as generic text.
+	 */
+	typedef bool (*info_parser)(const char* begin, const char* end, info_message& dst);
+
+	/**
+	 * Get the parser for the info log format used by a vendor. Unknown
+	 * vendors are parsed as Mesa with a fallback to the generic
+	 * "ERROR: 0:12: message" format.
+	 */
+	info_parser select_info_parser(vendor_t vendor);
+
+}
+
+#endif /* __GLSL_FX_INFO_LOG_H */
@@ -30,8 +30,8 @@
 #endif /* HAVE_CONFIG_H */
 
 #include "glslfx/glslfx.h"
+#include "path_table.h"
 #include <cstring>
-#include <map>
 
 int glslfx_init(){
 	return 0;
@@ -44,12 +44,7 @@ int glslfx_cleanup(){
 namespace glslfx {
 	static vendor_t g_vendor = VENDOR_UNKNOWN;
 
-	typedef std::map<path_handle_t, std::string> path_map;
-	typedef std::pair<path_handle_t, std::string> path_pair;
-	typedef path_map::iterator path_iterator;
-
-	static path_map g_paths;
-	unsigned int g_path_counter = 0;
+	static path_table g_paths;
 
 	vendor_t get_vendor(){
 		/* if vendor is unknown try to guess */
@@ -70,28 +65,17 @@ namespace glslfx {
 	}
 
 	int path_store(const std::string& path, path_handle_t& handle){
-		/* search if path is already stored */
-		for ( path_iterator it = g_paths.begin(); it != g_paths.end(); ++it ){
-			if ( it->second == path ){
-				handle = it->first;
-				return 0;
-			}
-		}
-
-		/* store */
-		handle = g_path_counter++;
-		g_paths.insert(path_pair(handle, path));
-		return 0;
+		return g_paths.store(path, handle);
 	}
 
 	int path_retrieve(const path_handle_t handle, std::string& path){
-		path_iterator it = g_paths.find(handle);
+		const std::string* tmp = g_paths.retrieve(handle);
 
-		if ( it == g_paths.end() ){
+		if ( !tmp ){
 			return E_NOT_FOUND;
 		}
 
-		path = it->second;
+		path = *tmp;
 		return 0;
 	}
 }
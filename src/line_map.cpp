@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "line_map.h"
+#include "glslfx/glslfx.h"
+
+const unsigned int line_map::unmapped;
+
+line_map::line_map()
+	: _lines(0) {
+
+}
+
+void line_map::append(unsigned int handle, unsigned int line, unsigned int count){
+	if ( count == 0 ){
+		return;
+	}
+
+	const unsigned int first = _lines + 1;
+	_lines += count;
+
+	/* extend the last run if the lines follows directly */
+	if ( !_runs.empty() ){
+		const run& last = _runs.back();
+		if ( last.handle == handle && last.line + (first - last.first) == line ){
+			return;
+		}
+	}
+
+	run tmp;
+	tmp.first = first;
+	tmp.handle = handle;
+	tmp.line = line;
+	_runs.push_back(tmp);
+}
+
+int line_map::find(unsigned int line, unsigned int& handle, unsigned int& src_line) const {
+	if ( line == 0 || line > _lines ){
+		return E_NOT_FOUND;
+	}
+
+	/* binary search for the last run starting at or before line */
+	size_t lo = 0;
+	size_t hi = _runs.size();
+	while ( hi - lo > 1 ){
+		size_t mid = (lo + hi) / 2;
+		if ( _runs[mid].first <= line ){
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+
+	const run& cur = _runs[lo];
+	handle = cur.handle;
+	src_line = cur.line + (line - cur.first);
+	return 0;
+}
+
+void line_map::clear(){
+	_runs.clear();
+	_lines = 0;
+}
+
+bool line_map::empty() const {
+	return _lines == 0;
+}
+
+unsigned int line_map::lines() const {
+	return _lines;
+}
+
+size_t line_map::runs() const {
+	return _runs.size();
+}
+
+int line_map::run_at(size_t index, unsigned int& first, unsigned int& handle, unsigned int& line) const {
+	if ( index >= _runs.size() ){
+		return E_OUT_OF_RANGE;
+	}
+
+	const run& cur = _runs[index];
+	first = cur.first;
+	handle = cur.handle;
+	line = cur.line;
+	return 0;
+}
@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GLSL_FX_LINE_MAP_H
+#define __GLSL_FX_LINE_MAP_H
+
+#include <cstddef>
+#include <vector>
+
+namespace glslfx {
+
+	/**
+	 * Maps lines of a generated source back to the file and line they came
+	 * from. Consecutive lines from the same file are stored as a single run.
+	 */
+	class line_map {
+	public:
+		/**
+		 * Handle of lines without a known origin.
+		 */
+		static const unsigned int unmapped = ~0u;
+
+		line_map();
+
+		/**
+		 * Append the origin of the next lines of the generated source.
+		 * @param handle Path handle of the file.
+		 * @param line Line in the file of the first line (1-based).
+		 * @param count Number of consecutive lines.
+		 */
+		void append(unsigned int handle, unsigned int line, unsigned int count = 1);
+
+		/**
+		 * Find the origin of a line in the generated source.
+		 * @param line Line in the generated source (1-based).
+		 * @param handle Output
+		 * @param src_line Output
+		 * @return 0 if successful or E_NOT_FOUND.
+		 */
+		int find(unsigned int line, unsigned int& handle, unsigned int& src_line) const;
+
+		void clear();
+		bool empty() const;
+
+		/**
+		 * Number of lines mapped.
+		 */
+		unsigned int lines() const;
+
+		/**
+		 * Number of runs stored.
+		 */
+		size_t runs() const;
+
+		/**
+		 * Get a stored run, eg. to serialize the map.
+		 * @param index Run index, see runs().
+		 * @param first Output, first line of the run in the generated source.
+		 * @param handle Output
+		 * @param line Output, line in the file of the first line.
+		 * @return 0 if successful or E_OUT_OF_RANGE.
+		 */
+		int run_at(size_t index, unsigned int& first, unsigned int& handle, unsigned int& line) const;
+
+	private:
+		typedef struct {
+			unsigned int first;  /* first line of the run in the generated source */
+			unsigned int handle;
+			unsigned int line;   /* line in the file of the first line */
+		} run;
+
+		std::vector<run> _runs;
+		unsigned int _lines;
+	};
+
+}
+
+#endif /* __GLSL_FX_LINE_MAP_H */
@@ -30,85 +30,422 @@
 #endif /* HAVE_CONFIG_H */
 
 #include "glslfx/log.h"
+#include "hash.h"
 #include <cstdio>
 #include <cstdlib>
 #include <cstdarg>
+#include <cctype>
+#include <algorithm>
 
-log::log(){
+/* size of arena chunks, longer strings get a chunk of their own */
+static const size_t chunk_size = 16384;
 
+/* source of batches and message sequence numbers */
+static uint64_t g_sequence = 0;
+
+/* innermost scope of each thread */
+static pthread_key_t g_scope_key;
+static pthread_once_t g_scope_once = PTHREAD_ONCE_INIT;
+
+static void create_scope_key(){
+	pthread_key_create(&g_scope_key, NULL);
+}
+
+static uint64_t next_sequence(){
+	return __sync_add_and_fetch(&g_sequence, 1);
+}
+
+/**
+ * Copy a string into an arena, null-terminated.
+ */
+static const char* arena_store(std::vector<char*>& chunks, size_t& used, const string_view& str){
+	const size_t size = str.size() + 1;
+	char* dst;
+
+	if ( size > chunk_size / 4 ){
+		/* long strings get a chunk of their own, placed before the current
+		 * chunk so its free space is still used */
+		dst = new char[size];
+		chunks.insert(chunks.empty() ? chunks.end() : chunks.end() - 1, dst);
+	} else {
+		if ( used + size > chunk_size ){
+			chunks.push_back(new char[chunk_size]);
+			used = 0;
+		}
+
+		dst = chunks.back() + used;
+		used += size;
+	}
+
+	memcpy(dst, str.data(), str.size());
+	dst[str.size()] = '\0';
+	return dst;
+}
+
+static void arena_release(std::vector<char*>& chunks, size_t& used){
+	for ( std::vector<char*>::iterator it = chunks.begin(); it != chunks.end(); ++it ){
+		delete [] *it;
+	}
+
+	chunks.clear();
+	used = chunk_size;
+}
+
+/**
+ * A message written by a thread which is not merged yet, the strings are
+ * stored in the arena of the buffer.
+ */
+typedef struct {
+	uint64_t batch;
+	uint64_t position;
+	uint64_t sequence;
+	severity_t severity;
+	unsigned int line;
+	string_view file;
+	string_view ref;
+	string_view message;
+} pending;
+
+/**
+ * Messages written by a single thread, only touched by the owning thread
+ * until the log is read.
+ */
+struct log::thread_buffer {
+	pthread_t owner;
+	thread_buffer* next;
+	std::vector<pending> entries;
+	std::vector<char*> chunks;
+	size_t chunk_used;
+};
+
+static bool pending_less(const pending* a, const pending* b){
+	if ( a->batch != b->batch ) return a->batch < b->batch;
+	if ( a->position != b->position ) return a->position < b->position;
+	return a->sequence < b->sequence;
+}
+
+log::scope::scope(const order_t& order)
+	: _order(order) {
+
+	pthread_once(&g_scope_once, create_scope_key);
+	_prev = (scope*)pthread_getspecific(g_scope_key);
+	pthread_setspecific(g_scope_key, this);
+}
+
+log::scope::~scope(){
+	pthread_setspecific(g_scope_key, _prev);
+}
+
+log::log()
+	: _buffers(NULL)
+	, _chunk_used(chunk_size) {
+
+	_interned.push_back(string_view());
+	pthread_mutex_init(&_lock, NULL);
+}
+
+log::log(const log& src)
+	: log_sink()
+	, _buffers(NULL)
+	, _chunk_used(chunk_size) {
+
+	_interned.push_back(string_view());
+	pthread_mutex_init(&_lock, NULL);
+	append(src);
 }
 
 log::~log(){
+	release();
+
+	thread_buffer* cur = _buffers;
+	while ( cur ){
+		thread_buffer* next = cur->next;
+		arena_release(cur->chunks, cur->chunk_used);
+		delete cur;
+		cur = next;
+	}
+
+	pthread_mutex_destroy(&_lock);
+}
 
+log& log::operator=(const log& src){
+	if ( this != &src ){
+		clear();
+		append(src);
+	}
+
+	return *this;
 }
 
 log::const_iterator log::begin() const{
+	const_cast<log*>(this)->sync();
 	return _entries.begin();
 }
 
 log::const_iterator log::end() const{
+	const_cast<log*>(this)->sync();
 	return _entries.end();
 }
 
 log::iterator log::begin(){
+	sync();
 	return _entries.begin();
 }
 
 log::iterator log::end(){
+	sync();
 	return _entries.end();
 }
 
-void log::message(unsigned int line,
-				  const std::string& file,
-				  const std::string& severity,
-				  const std::string& ref,
-				  const std::string& message){
-	entry tmp;
-	tmp.generic = false;
-	tmp.line = line;
-	tmp.file = file;
+size_t log::size() const {
+	const_cast<log*>(this)->sync();
+	return _entries.size();
+}
+
+void log::clear(){
+	pthread_mutex_lock(&_lock);
+
+	release();
+	_interned.push_back(string_view());
+
+	for ( thread_buffer* cur = _buffers; cur; cur = cur->next ){
+		cur->entries.clear();
+		arena_release(cur->chunks, cur->chunk_used);
+	}
+
+	pthread_mutex_unlock(&_lock);
+}
+
+void log::release(){
+	arena_release(_chunks, _chunk_used);
+	_entries.clear();
+	_keys.clear();
+	_interned.clear();
+	_intern_index.clear();
+}
+
+string_view log::file(const entry& entry) const {
+	return _interned[entry.file];
+}
+
+string_view log::ref(const entry& entry) const {
+	return _interned[entry.ref];
+}
+
+string_view log::text(const entry& entry) const {
+	return string_view(entry.message, entry.message_len);
+}
+
+uint64_t log::next_batch(){
+	return next_sequence();
+}
+
+uint64_t log::position(unsigned int effect, unsigned int technique, unsigned int pass, unsigned int stage){
+	const uint64_t mask = 0xffff;
+	return (std::min(effect, 0xffffU) & mask) << 48
+		| (std::min(technique, 0xffffU) & mask) << 32
+		| (std::min(pass, 0xffffU) & mask) << 16
+		| (std::min(stage, 0xffffU) & mask);
+}
+
+log::order_t log::current_order(){
+	pthread_once(&g_scope_once, create_scope_key);
+
+	const scope* cur = (const scope*)pthread_getspecific(g_scope_key);
+	if ( !cur ){
+		order_t tmp = {0, 0};
+		return tmp;
+	}
+
+	return cur->_order;
+}
+
+const char* log::severity_name(severity_t severity){
+	switch ( severity ){
+		case SEVERITY_NONE:    return "";
+		case SEVERITY_INFO:    return "info";
+		case SEVERITY_WARNING: return "warning";
+		case SEVERITY_ERROR:   return "error";
+		case SEVERITY_MAX:     break;
+	}
+
+	return "";
+}
+
+/**
+ * Case insensitive comparison with a lowercase name.
+ */
+static bool equals(const string_view& str, const char* name){
+	const size_t len = strlen(name);
+
+	if ( str.size() != len ){
+		return false;
+	}
+
+	for ( size_t i = 0; i < len; i++ ){
+		if ( tolower((unsigned char)str.data()[i]) != name[i] ){
+			return false;
+		}
+	}
+
+	return true;
+}
+
+severity_t log::parse_severity(const string_view& name){
+	if ( equals(name, "error") || equals(name, "fatal") ){
+		return SEVERITY_ERROR;
+	}
+
+	if ( equals(name, "warning") ){
+		return SEVERITY_WARNING;
+	}
+
+	return SEVERITY_INFO;
+}
+
+log::thread_buffer* log::buffer(){
+	const pthread_t self = pthread_self();
+
+	for ( thread_buffer* cur = _buffers; cur; cur = cur->next ){
+		if ( pthread_equal(cur->owner, self) ){
+			return cur;
+		}
+	}
+
+	/* first message from this thread, only this thread adds its own buffer
+	 * so it cannot have been added in the meantime */
+	thread_buffer* tmp = new thread_buffer;
+	tmp->owner = self;
+	tmp->chunk_used = chunk_size;
+
+	do {
+		tmp->next = _buffers;
+	} while ( !__sync_bool_compare_and_swap(&_buffers, tmp->next, tmp) );
+
+	return tmp;
+}
+
+void log::write(unsigned int line,
+				const string_view& file,
+				severity_t severity,
+				const string_view& ref,
+				const string_view& message){
+
+	thread_buffer* buf = buffer();
+	const order_t order = current_order();
+	pending tmp;
+
+	tmp.sequence = next_sequence();
+	tmp.batch = order.batch != 0 ? order.batch : tmp.sequence;
+	tmp.position = order.batch != 0 ? order.position : 0;
 	tmp.severity = severity;
-	tmp.ref = ref;
-	tmp.message = message;
+	tmp.line = line;
+	tmp.file = string_view(arena_store(buf->chunks, buf->chunk_used, file), file.size());
+	tmp.ref = string_view(arena_store(buf->chunks, buf->chunk_used, ref), ref.size());
+	tmp.message = string_view(arena_store(buf->chunks, buf->chunk_used, message), message.size());
 
-	_entries.push_back(tmp);
+	buf->entries.push_back(tmp);
+}
+
+bool log::ordered() const {
+	return true;
 }
 
-void log::format(unsigned int line,
-				 const std::string& file,
-				 const std::string& severity,
-				 const std::string& ref,
-				 const char* fmt, ...){
-	va_list ap;
-	va_start(ap, fmt);
-	vformat(line, file, severity, ref, fmt, ap);
-	va_end(ap);
+bool log::record_less(const record& a, const record& b){
+	if ( a.first.batch != b.first.batch ) return a.first.batch < b.first.batch;
+	if ( a.first.position != b.first.position ) return a.first.position < b.first.position;
+	return a.first.sequence < b.first.sequence;
 }
 
-void log::vformat(unsigned int line,
-				  const std::string& file,
-				  const std::string& severity,
-				  const std::string& ref,
-				  const char* fmt, va_list ap){
-	char* tmp = NULL;
+void log::sync(){
+	std::vector<const pending*> tmp;
+
+	pthread_mutex_lock(&_lock);
 
-	/* create string */
-	if ( vasprintf(&tmp, fmt, ap) == -1 ){
-		return; /* @todo handle ENOMEM*/
+	for ( thread_buffer* cur = _buffers; cur; cur = cur->next ){
+		for ( std::vector<pending>::const_iterator it = cur->entries.begin(); it != cur->entries.end(); ++it ){
+			tmp.push_back(&*it);
+		}
 	}
 
-	message(line, file, severity, ref, tmp);
-	free(tmp);
+	if ( tmp.empty() ){
+		pthread_mutex_unlock(&_lock);
+		return;
+	}
+
+	std::sort(tmp.begin(), tmp.end(), pending_less);
+
+	const size_t n = _entries.size();
+	for ( std::vector<const pending*>::const_iterator it = tmp.begin(); it != tmp.end(); ++it ){
+		const pending* cur = *it;
+		key k = {cur->batch, cur->position, cur->sequence};
+		push(cur->line, cur->file, cur->severity, cur->ref, cur->message);
+		_keys.push_back(k);
+	}
+
+	/* new entries usually go after all previous ones, otherwise the two
+	 * sorted ranges are merged */
+	if ( n > 0 && record_less(record(_keys[n], entry()), record(_keys[n - 1], entry())) ){
+		std::vector<record> all;
+		all.reserve(_entries.size());
+		for ( size_t i = 0; i < _entries.size(); i++ ){
+			all.push_back(record(_keys[i], _entries[i]));
+		}
+
+		std::inplace_merge(all.begin(), all.begin() + n, all.end(), record_less);
+
+		for ( size_t i = 0; i < all.size(); i++ ){
+			_keys[i] = all[i].first;
+			_entries[i] = all[i].second;
+		}
+	}
+
+	/* the text has been copied into the log */
+	for ( thread_buffer* cur = _buffers; cur; cur = cur->next ){
+		cur->entries.clear();
+		arena_release(cur->chunks, cur->chunk_used);
+	}
+
+	pthread_mutex_unlock(&_lock);
 }
 
-void log::generic(const std::string& message){
+void log::push(unsigned int line,
+			   const string_view& file,
+			   severity_t severity,
+			   const string_view& ref,
+			   const string_view& message){
 	entry tmp;
-	tmp.generic = true;
-	tmp.line = 0;
-	tmp.file = "";
-	tmp.severity = "";
-	tmp.ref = "";
-	tmp.message = message;
+	tmp.severity = severity;
+	tmp.line = line;
+	tmp.file = intern(file);
+	tmp.ref = intern(ref);
+	tmp.message = store(message);
+	tmp.message_len = message.size();
 
 	_entries.push_back(tmp);
 }
+
+const char* log::store(const string_view& str){
+	return arena_store(_chunks, _chunk_used, str);
+}
+
+unsigned int log::intern(const string_view& str){
+	if ( str.empty() ){
+		return 0;
+	}
+
+	const uint64_t key = glslfx::hash(str.data(), str.size());
+	std::map<uint64_t, unsigned int>::const_iterator it = _intern_index.find(key);
+	if ( it != _intern_index.end() && _interned[it->second] == str ){
+		return it->second;
+	}
+
+	/* colliding strings are stored without being indexed */
+	const unsigned int handle = _interned.size();
+	_interned.push_back(string_view(store(str), str.size()));
+	if ( it == _intern_index.end() ){
+		_intern_index[key] = handle;
+	}
+
+	return handle;
+}
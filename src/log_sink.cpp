@@ -0,0 +1,161 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "glslfx/log_sink.h"
+#include "glslfx/log.h"
+#include <cstdlib>
+#include <cstring>
+
+log_sink::~log_sink(){
+
+}
+
+bool log_sink::wants_text(severity_t) const {
+	return true;
+}
+
+bool log_sink::ordered() const {
+	return false;
+}
+
+void log_sink::message(unsigned int line,
+					   const string_view& file,
+					   severity_t severity,
+					   const string_view& ref,
+					   const string_view& message){
+	write(line, file, severity, ref, wants_text(severity) ? message : string_view());
+}
+
+void log_sink::format(unsigned int line,
+					  const string_view& file,
+					  severity_t severity,
+					  const string_view& ref,
+					  const char* fmt, ...){
+	va_list ap;
+	va_start(ap, fmt);
+	vformat(line, file, severity, ref, fmt, ap);
+	va_end(ap);
+}
+
+void log_sink::vformat(unsigned int line,
+					   const string_view& file,
+					   severity_t severity,
+					   const string_view& ref,
+					   const char* fmt, va_list ap){
+	char* tmp = NULL;
+
+	/* nobody reads the text, don't format it */
+	if ( !wants_text(severity) ){
+		write(line, file, severity, ref, string_view());
+		return;
+	}
+
+	/* create string */
+	if ( vasprintf(&tmp, fmt, ap) == -1 ){
+		return; /* @todo handle ENOMEM*/
+	}
+
+	write(line, file, severity, ref, tmp);
+	free(tmp);
+}
+
+void log_sink::generic(const string_view& message){
+	write(0, string_view(), SEVERITY_NONE, string_view(), wants_text(SEVERITY_NONE) ? message : string_view());
+}
+
+void log_sink::append(const log& src){
+	/* indexed as appending a log to itself grows it, the text itself stays
+	 * in place */
+	const size_t n = src.size();
+	for ( size_t i = 0; i < n; i++ ){
+		const log::entry cur = *(src.begin() + i);
+		message(cur.line, src.file(cur), cur.severity, src.ref(cur), src.text(cur));
+	}
+}
+
+file_sink::file_sink(FILE* fp)
+	: _fp(fp) {
+
+}
+
+void file_sink::write(unsigned int line,
+					  const string_view& file,
+					  severity_t severity,
+					  const string_view& ref,
+					  const string_view& message){
+
+	/* a single call so messages from several threads aren't interleaved */
+	if ( severity == SEVERITY_NONE ){
+		fprintf(_fp, "%.*s\n", (int)message.size(), message.data());
+	} else {
+		fprintf(_fp, "%.*s:%u %s%s%.*s: %.*s\n",
+				(int)file.size(), file.data(), line,
+				log::severity_name(severity), ref.empty() ? "" : " ",
+				(int)ref.size(), ref.data(),
+				(int)message.size(), message.data());
+	}
+}
+
+count_sink::count_sink(){
+	pthread_mutex_init(&_lock, NULL);
+	memset(_count, 0, sizeof(_count));
+}
+
+count_sink::~count_sink(){
+	pthread_mutex_destroy(&_lock);
+}
+
+void count_sink::write(unsigned int,
+					   const string_view&,
+					   severity_t severity,
+					   const string_view&,
+					   const string_view&){
+	pthread_mutex_lock(&_lock);
+	_count[severity]++;
+	pthread_mutex_unlock(&_lock);
+}
+
+bool count_sink::wants_text(severity_t) const {
+	return false;
+}
+
+unsigned int count_sink::count(severity_t severity) const {
+	pthread_mutex_lock(&_lock);
+	unsigned int n = _count[severity];
+	pthread_mutex_unlock(&_lock);
+	return n;
+}
+
+void count_sink::reset(){
+	pthread_mutex_lock(&_lock);
+	memset(_count, 0, sizeof(_count));
+	pthread_mutex_unlock(&_lock);
+}
@@ -0,0 +1,204 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "mapped_file.h"
+#include <cstdlib>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+mapped_file::mapped_file()
+	: _data(NULL)
+	, _size(0)
+	, _mapped(false)
+	, _provider(NULL) {
+
+	memset(&_st, 0, sizeof(_st));
+	memset(&_id, 0, sizeof(_id));
+}
+
+mapped_file::~mapped_file(){
+	close();
+}
+
+int mapped_file::open(const std::string& path){
+	void* addr;
+	int fd;
+	int ret;
+
+	close();
+
+	if ( ( fd = ::open(path.c_str(), O_RDONLY) ) == -1 ){
+		return errno;
+	}
+
+	if ( fstat(fd, &_st) != 0 ){
+		ret = errno;
+		::close(fd);
+		return ret;
+	}
+	include_cache::stat(_st, _id);
+
+	/* mmap cannot map empty files and special files have no meaningful size */
+	if ( !S_ISREG(_st.st_mode) || _st.st_size == 0 ){
+		ret = read_fallback(fd);
+		::close(fd);
+		return ret;
+	}
+
+	addr = mmap(NULL, _st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if ( addr == MAP_FAILED ){
+		ret = read_fallback(fd);
+		::close(fd);
+		return ret;
+	}
+
+	/* the mapping stays valid after the descriptor is closed */
+	::close(fd);
+
+	/* sources are always scanned from start to end */
+	madvise(addr, _st.st_size, MADV_SEQUENTIAL);
+
+	_data = (const char*)addr;
+	_size = _st.st_size;
+	_mapped = true;
+	return 0;
+}
+
+int mapped_file::open(const file_provider* provider, const std::string& path){
+	int ret;
+
+	if ( !provider ){
+		return open(path);
+	}
+
+	close();
+
+	if ( ( ret = provider->open(path, _file) ) != 0 ){
+		return ret;
+	}
+
+	_data = _file.data;
+	_size = _file.size;
+	_id = _file.id;
+	_provider = provider;
+	return 0;
+}
+
+int mapped_file::read_fallback(int fd){
+	size_t capacity = 0;
+	char* buf = NULL;
+	ssize_t n;
+
+	_size = 0;
+	_mapped = false;
+
+	for (;;){
+		if ( _size == capacity ){
+			capacity = capacity ? capacity * 2 : 4096;
+			char* tmp = (char*)realloc(buf, capacity);
+			if ( !tmp ){
+				free(buf);
+				close();
+				return ENOMEM;
+			}
+			buf = tmp;
+		}
+
+		n = read(fd, buf + _size, capacity - _size);
+		if ( n < 0 ){
+			if ( errno == EINTR ){
+				continue;
+			}
+
+			int ret = errno;
+			free(buf);
+			close();
+			return ret;
+		}
+
+		/* end of file */
+		if ( n == 0 ){
+			break;
+		}
+
+		_size += n;
+	}
+
+	_data = buf;
+	return 0;
+}
+
+void mapped_file::adopt(char* data, size_t size, const struct stat& st){
+	close();
+
+	_st = st;
+	include_cache::stat(_st, _id);
+	_data = data;
+	_size = size;
+	_mapped = false;
+}
+
+void mapped_file::close(){
+	if ( _provider ){
+		_provider->close(_file);
+		_provider = NULL;
+	} else if ( _data ){
+		if ( _mapped ){
+			munmap((void*)_data, _size);
+		} else {
+			free((void*)_data);
+		}
+	}
+
+	_data = NULL;
+	_size = 0;
+	_mapped = false;
+}
+
+const struct stat& mapped_file::info() const {
+	return _st;
+}
+
+const include_cache::identity& mapped_file::id() const {
+	return _id;
+}
+
+const char* mapped_file::data() const {
+	return _data;
+}
+
+size_t mapped_file::size() const {
+	return _size;
+}
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GLSL_FX_MAPPED_FILE_H
+#define __GLSL_FX_MAPPED_FILE_H
+
+#include <glslfx/file_provider.h>
+#include <string>
+#include <cstddef>
+#include <sys/stat.h>
+
+namespace glslfx {
+
+	/**
+	 * Read-only view of a file. The file is memory-mapped when possible and
+	 * read into a private buffer otherwise (eg. pipes or empty files). The
+	 * descriptor is closed as soon as the contents are available so views
+	 * may be kept around without holding on to descriptors.
+	 */
+	class mapped_file {
+	public:
+		mapped_file();
+		~mapped_file();
+
+		/**
+		 * Open and map a file.
+		 * @param path
+		 * @return 0 if successful or errno.
+		 */
+		int open(const std::string& path);
+
+		/**
+		 * Open a file through a provider, the contents are used as
+		 * provided without copying.
+		 * @param provider Provider to read from, NULL to open the file
+		 *                 directly.
+		 * @param path
+		 * @return 0 if successful or errno.
+		 */
+		int open(const file_provider* provider, const std::string& path);
+
+		/**
+		 * Take ownership of contents read elsewhere.
+		 * @param data Contents allocated with malloc.
+		 * @param size
+		 * @param st Status of the file the contents were read from.
+		 */
+		void adopt(char* data, size_t size, const struct stat& st);
+
+		/**
+		 * Unmap and close the file.
+		 */
+		void close();
+
+		/**
+		 * Status of the file at the time it was opened.
+		 */
+		const struct stat& info() const;
+
+		/**
+		 * Identity of the file at the time it was opened.
+		 */
+		const include_cache::identity& id() const;
+
+		const char* data() const;
+		size_t size() const;
+
+	private:
+		mapped_file(const mapped_file&);
+		mapped_file& operator=(const mapped_file&);
+
+		int read_fallback(int fd);
+
+		struct stat _st;
+		include_cache::identity _id;
+		const char* _data;
+		size_t _size;
+		bool _mapped; /* true if _data is mmap'ed, false if malloc'ed */
+		const file_provider* _provider; /* set if _data belongs to a provider */
+		file_provider::file _file;
+	};
+
+}
+
+#endif /* __GLSL_FX_MAPPED_FILE_H */
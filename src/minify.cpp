@@ -0,0 +1,391 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "minify.h"
+#include "glslfx/effect.h"
+#include <cstring>
+#include <cctype>
+#include <set>
+
+/**
+ * A line of minified output.
+ */
+typedef struct {
+	std::string text;
+	unsigned int handle;  /* origin of the line */
+	unsigned int line;
+	bool directive;       /* preprocessor directive, kept on its own line */
+} output_line;
+
+static bool is_ident(char c){
+	return isalnum((unsigned char)c) || c == '_';
+}
+
+/**
+ * Characters which may combine into a different token if the whitespace
+ * between them is removed (eg. "a - -b").
+ */
+static bool is_operator(char c){
+	return c != '\0' && strchr("+-*/%<>=!&|^~?:.", c) != NULL;
+}
+
+/**
+ * Get the origin of a line of the input, lines outside the map are
+ * unmapped.
+ */
+static void origin(const line_map& map, unsigned int line, output_line& dst){
+	if ( map.find(line, dst.handle, dst.line) != 0 ){
+		dst.handle = line_map::unmapped;
+		dst.line = line;
+	}
+}
+
+/**
+ * Strip comments and collapse whitespace on a single line. Directives keep
+ * a single space between tokens as it may be significant (eg. function-like
+ * macros), otherwise whitespace is only kept where needed to separate
+ * tokens.
+ */
+static std::string strip(const char* p, const char* end, bool& in_comment, bool directive){
+	std::string out;
+	bool space = false;
+
+	for ( ; p < end; p++ ){
+		const char c = *p;
+
+		if ( in_comment ){
+			if ( c == '*' && p + 1 < end && p[1] == '/' ){
+				in_comment = false;
+				space = true;
+				p++;
+			}
+			continue;
+		}
+
+		if ( c == '/' && p + 1 < end && p[1] == '/' ){
+			break;
+		}
+
+		if ( c == '/' && p + 1 < end && p[1] == '*' ){
+			in_comment = true;
+			space = true;
+			p++;
+			continue;
+		}
+
+		if ( isspace((unsigned char)c) ){
+			space = true;
+			continue;
+		}
+
+		if ( space && !out.empty() ){
+			const char prev = out[out.size() - 1];
+			if ( directive || ( is_ident(prev) && is_ident(c) ) || ( is_operator(prev) && is_operator(c) ) ){
+				out += ' ';
+			}
+		}
+
+		space = false;
+		out += c;
+	}
+
+	return out;
+}
+
+/**
+ * A function definition found at global scope.
+ */
+typedef struct {
+	std::string name;
+	size_t begin;                /* start of the definition (including return type) */
+	size_t end;                  /* one past the closing brace */
+	std::set<std::string> refs;  /* identifiers used in parameters and body */
+} function;
+
+static size_t skip_space(const std::string& s, size_t i){
+	while ( i < s.size() && isspace((unsigned char)s[i]) ) i++;
+	return i;
+}
+
+/**
+ * Find the matching close character, i pointing at the open character.
+ */
+static size_t match(const std::string& s, size_t i, char open, char close){
+	int depth = 0;
+
+	for ( ; i < s.size(); i++ ){
+		if ( s[i] == open ) depth++;
+		if ( s[i] == close && --depth == 0 ) return i;
+	}
+
+	return std::string::npos;
+}
+
+static void identifiers(const std::string& s, size_t begin, size_t end, std::set<std::string>& dst){
+	for ( size_t i = begin; i < end; ){
+		if ( !is_ident(s[i]) ){
+			i++;
+			continue;
+		}
+
+		size_t j = i;
+		while ( j < end && is_ident(s[j]) ) j++;
+		if ( !isdigit((unsigned char)s[i]) ){
+			dst.insert(s.substr(i, j - i));
+		}
+		i = j;
+	}
+}
+
+/**
+ * Remove function definitions which cannot be reached from main, or from
+ * any identifier used at global scope.
+ */
+static void remove_dead_functions(std::vector<output_line>& lines){
+	std::string code;                 /* all code lines, separated by newlines */
+	std::vector<size_t> origin;       /* index of each code line in lines */
+	std::vector<function> functions;
+	std::set<std::string> globals;    /* identifiers used at global scope */
+	std::set<std::string> defined;
+
+	for ( size_t i = 0; i < lines.size(); i++ ){
+		if ( lines[i].directive ){
+			/* conditionals left to the driver, a definition may be split
+			 * between branches (directives keep a space after '#') */
+			if ( lines[i].text.compare(skip_space(lines[i].text, 1), 2, "if") == 0 ) return;
+			continue;
+		}
+		code += lines[i].text;
+		code += '\n';
+		origin.push_back(i);
+	}
+
+	/* find all definitions */
+	size_t statement = 0;
+	int depth = 0;
+	for ( size_t i = 0; i < code.size(); ){
+		const char c = code[i];
+
+		if ( depth > 0 ){
+			if ( c == '{' ) depth++;
+			if ( c == '}' && --depth == 0 ) statement = i + 1;
+			if ( is_ident(c) ){
+				size_t j = i;
+				while ( j < code.size() && is_ident(code[j]) ) j++;
+				identifiers(code, i, j, globals);
+				i = j;
+				continue;
+			}
+			i++;
+			continue;
+		}
+
+		if ( c == ';' ){
+			statement = i + 1;
+		}
+
+		if ( c == '{' ){
+			depth++;
+		}
+
+		if ( !is_ident(c) ){
+			i++;
+			continue;
+		}
+
+		size_t j = i;
+		while ( j < code.size() && is_ident(code[j]) ) j++;
+
+		const std::string name = code.substr(i, j - i);
+		size_t open = skip_space(code, j);
+		size_t close = open < code.size() && code[open] == '(' ? match(code, open, '(', ')') : std::string::npos;
+		size_t body = close == std::string::npos ? close : skip_space(code, close + 1);
+
+		if ( body == std::string::npos || body >= code.size() || code[body] != '{' ){
+			if ( !isdigit((unsigned char)c) ){
+				globals.insert(name);
+			}
+			i = j;
+			continue;
+		}
+
+		size_t last = match(code, body, '{', '}');
+		if ( last == std::string::npos ){
+			return; /* unbalanced, leave source alone */
+		}
+
+		function tmp;
+		tmp.name = name;
+		tmp.begin = statement;
+		tmp.end = last + 1;
+		identifiers(code, open, last, tmp.refs);
+		functions.push_back(tmp);
+		defined.insert(name);
+
+		i = statement = last + 1;
+	}
+
+	/* without main it is not a complete shader */
+	if ( defined.find("main") == defined.end() ){
+		return;
+	}
+
+	/* mark everything reachable */
+	std::set<std::string> live;
+	std::vector<std::string> pending(1, "main");
+	for ( std::set<std::string>::const_iterator it = globals.begin(); it != globals.end(); ++it ){
+		if ( defined.find(*it) != defined.end() ){
+			pending.push_back(*it);
+		}
+	}
+
+	while ( !pending.empty() ){
+		const std::string name = pending.back();
+		pending.pop_back();
+
+		if ( !live.insert(name).second ){
+			continue;
+		}
+
+		for ( std::vector<function>::const_iterator it = functions.begin(); it != functions.end(); ++it ){
+			if ( it->name != name ) continue;
+
+			for ( std::set<std::string>::const_iterator ref = it->refs.begin(); ref != it->refs.end(); ++ref ){
+				if ( defined.find(*ref) != defined.end() && live.find(*ref) == live.end() ){
+					pending.push_back(*ref);
+				}
+			}
+		}
+	}
+
+	std::vector<bool> removed(code.size(), false);
+	bool any = false;
+	for ( std::vector<function>::const_iterator it = functions.begin(); it != functions.end(); ++it ){
+		if ( live.find(it->name) != live.end() ) continue;
+		std::fill(removed.begin() + it->begin, removed.begin() + it->end, true);
+		any = true;
+	}
+
+	if ( !any ){
+		return;
+	}
+
+	/* write back what remains of each line, newlines are never removed */
+	size_t pos = 0;
+	for ( size_t n = 0; n < origin.size(); n++ ){
+		std::string text;
+		bool space = false;
+
+		for ( ; code[pos] != '\n'; pos++ ){
+			if ( removed[pos] ) continue;
+			if ( code[pos] == ' ' ){
+				space = !text.empty();
+				continue;
+			}
+			if ( space ) text += ' ';
+			space = false;
+			text += code[pos];
+		}
+		pos++;
+
+		lines[origin[n]].text = text;
+	}
+}
+
+void glslfx::minify(const source_list& src, unsigned int flags, source_list& dst){
+	std::vector<output_line> lines;
+	std::string text;
+	bool in_comment = false;
+	unsigned int line = 1;     /* next input line */
+
+	dst.clear();
+	src.str(text);
+
+	for ( size_t pos = 0; pos < text.size(); ){
+		size_t eol = text.find('\n', pos);
+		if ( eol == std::string::npos ){
+			eol = text.size();
+		}
+
+		const char* begin = text.data() + pos;
+		const char* end = text.data() + eol;
+		output_line cur;
+		origin(src.lines(), line++, cur);
+		cur.directive = false;
+		pos = eol + 1;
+
+		/* directives */
+		const char* p = begin;
+		while ( p < end && isspace((unsigned char)*p) ) p++;
+		if ( !in_comment && p < end && *p == '#' ){
+			cur.directive = true;
+
+			/* continued lines are passed through untouched */
+			if ( end > p && end[-1] == '\\' ){
+				cur.text.assign(begin, end);
+				lines.push_back(cur);
+
+				while ( pos < text.size() && text[eol - 1] == '\\' ){
+					eol = text.find('\n', pos);
+					if ( eol == std::string::npos ){
+						eol = text.size();
+					}
+
+					cur.text.assign(text, pos, eol - pos);
+					origin(src.lines(), line++, cur);
+					lines.push_back(cur);
+					pos = eol + 1;
+				}
+				continue;
+			}
+		}
+
+		cur.text = strip(begin, end, in_comment, cur.directive);
+		if ( !cur.text.empty() ){
+			lines.push_back(cur);
+		}
+	}
+
+	if ( flags & MINIFY_DEAD_FUNCTIONS ){
+		remove_dead_functions(lines);
+	}
+
+	std::string out;
+	out.reserve(text.size());
+	for ( std::vector<output_line>::const_iterator it = lines.begin(); it != lines.end(); ++it ){
+		if ( it->text.empty() ) continue;
+		out += it->text;
+		out += '\n';
+		dst.lines().append(it->handle, it->line);
+	}
+
+	dst.append_text(out);
+}
@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "name_index.h"
+#include "glslfx/glslfx.h"
+#include "hash.h"
+
+/* effects rarely have more than a handful of techniques or passes */
+static const size_t initial_slots = 8;
+
+name_index::name_index()
+	: _slots(initial_slots, 0)
+	, _mask(initial_slots - 1) {
+
+}
+
+uint32_t* name_index::probe(uint64_t hash, const string_view& name) const {
+	size_t i = (size_t)hash & _mask;
+
+	for ( ;; i = (i + 1) & _mask ){
+		uint32_t* slot = &_slots[i];
+
+		if ( *slot == 0 ){
+			return slot;
+		}
+
+		const item& cur = _items[*slot - 1];
+		if ( cur.hash == hash && string_view(cur.name) == name ){
+			return slot;
+		}
+	}
+}
+
+int name_index::insert(const string_view& name, unsigned int id){
+	const uint64_t h = glslfx::hash(name.data(), name.size());
+	uint32_t* slot = probe(h, name);
+
+	if ( *slot != 0 ){
+		return E_NOT_SET;
+	}
+
+	item tmp;
+	tmp.hash = h;
+	tmp.name = name.str();
+	tmp.id = id;
+	_items.push_back(tmp);
+
+	/* keep the load factor below 1/2 */
+	if ( _items.size() * 2 > _mask + 1 ){
+		grow();
+		slot = probe(h, name);
+	}
+
+	*slot = (uint32_t)_items.size();
+	return 0;
+}
+
+int name_index::find(const string_view& name, unsigned int& id) const {
+	const uint64_t h = glslfx::hash(name.data(), name.size());
+	const uint32_t value = *probe(h, name);
+
+	if ( value == 0 ){
+		return E_NOT_FOUND;
+	}
+
+	id = _items[value - 1].id;
+	return 0;
+}
+
+size_t name_index::size() const {
+	return _items.size();
+}
+
+void name_index::grow(){
+	const size_t slots = (_mask + 1) * 2;
+	_slots.assign(slots, 0);
+	_mask = slots - 1;
+
+	/* the newest item is left out, it is inserted by the caller */
+	for ( size_t i = 0; i + 1 < _items.size(); i++ ){
+		*probe(_items[i].hash, _items[i].name) = (uint32_t)(i + 1);
+	}
+}
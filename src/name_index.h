@@ -0,0 +1,96 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GLSL_FX_NAME_INDEX_H
+#define __GLSL_FX_NAME_INDEX_H
+
+#include <glslfx/string_view.h>
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace glslfx {
+
+	/**
+	 * Names of techniques or passes, mapping each distinct name to the id
+	 * it was inserted with. The hash of each name is computed once when it
+	 * is inserted and names are found through an open addressing index, so
+	 * a lookup hashes the key once and compares strings only on a hash
+	 * match. Not thread-safe, names are only added while an effect is
+	 * parsed or loaded.
+	 */
+	class name_index {
+	public:
+		name_index();
+
+		/**
+		 * Add a name unless it is already present.
+		 * @param name
+		 * @param id Id to map the name to.
+		 * @return 0 if added or E_NOT_SET if the name already exists (the
+		 *         existing mapping is kept).
+		 */
+		int insert(const string_view& name, unsigned int id);
+
+		/**
+		 * Get the id of a name.
+		 * @return 0 if successful or E_NOT_FOUND.
+		 */
+		int find(const string_view& name, unsigned int& id) const;
+
+		/**
+		 * Number of names.
+		 */
+		size_t size() const;
+
+	private:
+		typedef struct {
+			uint64_t hash;
+			std::string name;
+			unsigned int id;
+		} item;
+
+		/**
+		 * Search for a name, returns the slot where it is stored or the
+		 * empty slot where it would be stored.
+		 */
+		uint32_t* probe(uint64_t hash, const string_view& name) const;
+
+		/**
+		 * Double the number of slots.
+		 */
+		void grow();
+
+		std::vector<item> _items;
+		mutable std::vector<uint32_t> _slots; /* item + 1, 0 if empty */
+		size_t _mask;                         /* number of slots - 1 */
+	};
+
+}
+
+#endif /* __GLSL_FX_NAME_INDEX_H */
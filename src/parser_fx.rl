@@ -33,21 +33,18 @@
 #include "glslfx/glslfx.h"
 #include <GL/gl.h>
 
-#include <cstdio>
 #include <cstring>
 #include <cstdlib>
 #include <cassert>
 
-#define BUFLEN 1024
-
 struct state_t {
-	char buffer[BUFLEN+1];
-	int buflen;
+	const char* tok;    /* start of the current token */
+	string_view token;  /* last complete token, points into the parsed buffer */
 	int cs;
 	int top;
 	int act;
-	char* ts;
-	char* te;
+	const char* ts;
+	const char* te;
 
 	int* stack;
 	int stack_size;
@@ -56,6 +53,8 @@ struct state_t {
 
 	technique* cur_tech;
 	pass* cur_pass;
+
+	int error;          /* first error from building the effect, parsing continues */
 };
 
 
@@ -70,55 +69,57 @@ struct state_t {
 		}
 	}
 
-    # Append to the buffer.
-	action append {
-		if ( fsm->buflen < BUFLEN ){
-			fsm->buffer[fsm->buflen++] = fc;
-		}
-	}
+	# Mark the start of a token.
+	action mark { fsm->tok = fpc; }
+
+	# Mark the start of a token after the current character.
+	action mark_next { fsm->tok = fpc + 1; }
 
-	# Terminate a buffer.
-	action term {
-		if ( fsm->buflen < BUFLEN )
-			fsm->buffer[fsm->buflen++] = 0;
+	# Capture the token, the whole input is in memory so it is never split.
+	action capture {
+		fsm->token = string_view(fsm->tok, fpc - fsm->tok);
 	}
 
-	action term_program_type {
-		if ( fsm->buflen < BUFLEN )
-			fsm->buffer[fsm->buflen++] = 0;
-		if ( strcmp(fsm->buffer, "vertex") == 0 ){
+	action capture_program_type {
+		fsm->token = string_view(fsm->tok, fpc - fsm->tok);
+		if ( fsm->token == "vertex" ){
 			fsm->program_type = GL_VERTEX_SHADER;
 		}
-		if ( strcmp(fsm->buffer, "geometry") == 0 ){
+		if ( fsm->token == "geometry" ){
 			fsm->program_type = GL_GEOMETRY_SHADER;
 		}
-		if ( strcmp(fsm->buffer, "fragment") == 0 ){
+		if ( fsm->token == "fragment" ){
 			fsm->program_type = GL_FRAGMENT_SHADER;
 		}
 	}
 
-	action clear { fsm->buflen = 0; }
-
-	name = alnum+ >clear $append %term;
-	file_unquoted = [^\n \t;]+ >clear $append %term;
-	file_quoted =  [^'"]* >clear $append %term;
-	file = ( ['"] file_quoted ['"] | file_unquoted );
-    program_type = ('vertex'|'fragment'|'geometry') >clear $append %term_program_type;
-	string = [^0]+ >clear $append %term;
+	name = alnum+ >mark %capture;
+	identifier = ( [a-zA-Z_] [a-zA-Z0-9_]* ) >mark %capture;
+	file_unquoted = [^\n \t;]+ >mark %capture;
+	file_quoted = [^'"]* %capture;
+	file = ( ['"] @mark_next file_quoted ['"] | file_unquoted );
+    program_type = ('vertex'|'fragment'|'geometry') >mark %capture_program_type;
 	# name = [a-zA-Z]+;
 
  pass := |*
 	'}' => { fret; };
 space;
 program_type ':' space* file => {
-	fsm->cur_pass->set_path(fsm->program_type, fsm->buffer);
+	fsm->cur_pass->set_path(fsm->program_type, fsm->token.str());
+};
+# boolean macro toggled by variants, eg "keyword: USE_FOG"
+'keyword' ':' space* identifier => {
+	const int ret = fsm->cur_pass->add_keyword(fsm->token.str());
+	if ( ret != 0 && fsm->error == 0 ){
+		fsm->error = ret;
+	}
 };
 	 *|;
 
  technique := |*
 	 space;
 'pass' space+ name space+ '{' => {
-	pass* pass = fsm->cur_tech->pass_new(std::string(fsm->buffer));
+	pass* pass = fsm->cur_tech->pass_new(fsm->token.str());
 	fsm->cur_pass = pass;
 
 	fcall pass;
@@ -128,73 +129,42 @@ program_type ':' space* file => {
 
 main := (
 		 space* 'technique' space+ name space+ '{' @{
-			 technique* tech = ep->technique_new(std::string(fsm->buffer));
+			 technique* tech = ep->technique_new(fsm->token.str());
 			 fsm->cur_tech = tech;
 			 fcall technique;
-			 printf("tech fin\n");
 		 }
 		 )+;
 }%%
 
 %% write data;
 
-static int parse_fx_int(FILE* fp, effect* ep, struct state_t* fsm){
-	char buf[BUFLEN] = {0};
-	int have = 0;
-	int done = 0;
+static int parse_fx_int(const char* data, size_t size, effect* ep, struct state_t* fsm){
+	const char* p = data;
+	const char* pe = data + size;
+	const char* eof = pe;
 
-	assert(fp);
+	assert(data || size == 0);
 	assert(fsm);
 
-	fsm->buflen = 0;
-
 	%% write init;
+	%% write exec;
 
-	while ( !done ){
-		char *p = buf + have, *pe, *eof = 0;
-		int len, space = BUFLEN - have;
-
-		if ( space == 0 ){
-			printf("token error\n");
-			return E_TOKEN_ERROR;
-		}
-
-		len = fread(p, 1, space, fp);
-		pe = p + len;
-
-		/* Check if this is the end of file. */
-		if ( len < space ) {
-			eof = pe;
-			done = 1;
-		}
-                        
-		%% write exec;
-
-		if ( fsm->cs == fx_parser_error ) {
-			printf("parse error\n");
-			return E_PARSE_ERROR;
-		}
-
-		if ( fsm->ts == 0 )
-			have = 0;
-		else {
-			/* There is a prefix to preserve, shift it over. */
-			have = pe - fsm->ts;
-			memmove( buf, fsm->ts, have );
-			fsm->te = buf + (fsm->te - fsm->ts);
-			fsm->ts = buf;
-		}
-
+	if ( fsm->cs == fx_parser_error ) {
+		return E_PARSE_ERROR;
 	}
 
-	return 0;
+	return fsm->error;
 }
 
-int effect::parse_fx(FILE* fp){
-     struct state_t fsm;
-     assert(fp);
+int effect::parse_fx(const char* data, size_t size){
+	struct state_t fsm;
+	int ret;
+
+	fsm.stack = NULL;
+	fsm.stack_size = 0;
+	fsm.error = 0;
+	ret = parse_fx_int(data, size, this, &fsm);
 
-     fsm.stack = NULL;
-     fsm.stack_size = 0;
-     return parse_fx_int(fp, this, &fsm);
+	free(fsm.stack);
+	return ret;
 }
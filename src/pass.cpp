@@ -31,60 +31,122 @@
 
 #include "glslfx/pass.h"
 #include "glslfx/glslfx.h"
+#include "glslfx/include_cache.h"
+#include "glslfx/thread_pool.h"
+#include "mapped_file.h"
+#include "source_list.h"
+#include "expression.h"
+#include "hash.h"
+#include "minify.h"
+#include "info_log.h"
+#include "baked.h"
+#include "prefetch.h"
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
-#include <memory>
 #include <cassert>
 #include <errno.h>
-#include <sstream>
+#include <algorithm>
+#include <map>
+#include <set>
 
 #ifdef WIN32
 #	define _CRT_SECURE_NO_WARNINGS
 #	include <windows.h>
-#	include <yvals.h>
 #endif
 
-#if defined(_MSC_VER) && defined(_HAS_TR1)
-#	define HAVE_TR1_REGEX 1
-#endif
+/**
+ * Skip spaces and tabs.
+ */
+static const char* skip_space(const char* p, const char* end){
+	while ( p < end && (*p == ' ' || *p == '\t') ){
+		p++;
+	}
 
-/* currently the status of TR1 regex in libstdc++ is suboptimal so it is
- * disabled for now */
-#ifdef __GNUC__
-#	undef HAVE_TR1_REGEX
-#endif
+	return p;
+}
+
+/**
+ * Get the preprocessor command of a line, eg. "include" in "#  include <foo>".
+ * Returns NULL if the line isn't a preprocessor line.
+ */
+static const char* get_directive(const char* p, const char* end){
+	p = skip_space(p, end);
+	if ( p == end || *p != '#' ){
+		return NULL;
+	}
 
-#ifdef HAVE_TR1_REGEX
-#	include <tr1/regex>
-	using std::tr1::cmatch;
-	using std::tr1::regex;
-	using std::tr1::regex_search;
-#else /* HAVE_TR1_REGEX */
-#	define BOOST_REGEX_DYN_LINK /* boost::regex does not seem to link properly
-	                             * when using the static library. Must force it
-	                             * to use dynamic library. */
-#	include <boost/regex.hpp>
-	using boost::cmatch;
-	using boost::regex;
-	using boost::regex_search;
-#endif /* HAVE_TR1_REGEX */
+	return skip_space(p + 1, end);
+}
 
 /**
- * Similar to strchr but looks for the first character matching fun.
+ * Tell if the preprocessor command cmd (ending at end) is name.
  */
-static const char* strchr_fun(const char* s, int(*fun)(int c)){
-	const char* p = s;
-	while ( *p && !fun(*p) ){
+static bool is_directive(const char* cmd, const char* end, const char* name){
+	size_t len = strlen(name);
+
+	if ( !cmd || (size_t)(end - cmd) < len || strncmp(cmd, name, len) != 0 ){
+		return false;
+	}
+
+	/* must not be a prefix of a longer word, eg #includes */
+	return cmd + len == end || !(isalnum((unsigned char)cmd[len]) || cmd[len] == '_');
+}
+
+/**
+ * Get the identifier following a preprocessor command, eg. "FOO" in
+ * "ifndef FOO".
+ */
+static void get_identifier(const char* cmd, const char* end, std::string& dst){
+	const char* p = cmd;
+	const char* sp;
+
+	/* skip the command itself */
+	while ( p < end && isalpha((unsigned char)*p) ){
 		p++;
 	}
 
-	/* to match strchr which return NULL if it wasn't found */
-	if ( !*p ){
-		return NULL;
+	p = skip_space(p, end);
+	sp = p;
+	while ( p < end && (isalnum((unsigned char)*p) || *p == '_') ){
+		p++;
 	}
 
-	return p;
+	dst.assign(sp, p - sp);
+}
+
+/**
+ * Tell if a line only contains whitespace and comments. in_comment tracks
+ * whenever a block comment continues from the previous line.
+ */
+static bool is_blank(const char* p, const char* end, bool& in_comment){
+	bool blank = true;
+
+	while ( p < end ){
+		if ( in_comment ){
+			if ( p + 1 < end && p[0] == '*' && p[1] == '/' ){
+				in_comment = false;
+				p += 2;
+			} else {
+				p++;
+			}
+			continue;
+		}
+
+		if ( isspace((unsigned char)*p) ){
+			p++;
+		} else if ( p + 1 < end && p[0] == '/' && p[1] == '/' ){
+			break;
+		} else if ( p + 1 < end && p[0] == '/' && p[1] == '*' ){
+			in_comment = true;
+			p += 2;
+		} else {
+			blank = false;
+			p++;
+		}
+	}
+
+	return blank;
 }
 
 /**
@@ -100,11 +162,11 @@ static char term(char ch){
 }
 
 /**
- * Extract the filename from a preprocessor include line.
+ * Locate the filename in a preprocessor include line ending at end.
  * The #-sign is expected to be stripped already, eg:
  * include <foo>
  */
-static int get_include(const char* line, char** filename){
+static int get_include(const char* line, const char* end, const char** filename, size_t* size){
 	/*
 	 * delim ------+
 	 *             v
@@ -115,158 +177,925 @@ static int get_include(const char* line, char** filename){
 	 *  ep -----------+
 	 */
 
-	char delim = *(line + 8);
+	const char* delim = NULL;
 	const char* sp = NULL;
 	const char* ep = NULL;
-	size_t size = 0;
 
 	assert(line);
 	assert(filename);
+	assert(size);
 
-	/* reset pointer */
-	*filename = NULL;
+	/* find delimiter */
+	delim = skip_space(line + 7, end);
 
 	/* ensure valid delimiter */
-	if ( !(delim == '<' || delim == '"' ) ){
+	if ( delim == end || !(*delim == '<' || *delim == '"' ) ){
 		return E_PARSE_ERROR;
 	}
 
 	/* calculate offsets */
-	sp = line + 9;
-	ep = strchr(sp, term(delim));
-	size = ep - sp;
-
-	/* copy filename */
-	*filename = strndup(sp, size);
+	sp = delim + 1;
+	ep = (const char*)memchr(sp, term(*delim), end - sp);
+	if ( !ep ){
+		return E_PARSE_ERROR;
+	}
 
+	*filename = sp;
+	*size = ep - sp;
 	return 0;
 }
 
-static int source_file(const effect* ep,
-					   const pass* pass,
-					   std::stringstream& stream,
-					   const std::string& filename,
-					   FILE* fp,
-					   glslfx::log* log){
+/**
+ * Parse the line number of a #line directive, cmd pointing at "line".
+ */
+static size_t get_line(const char* cmd, const char* end){
+	const char* p = skip_space(cmd + 4, end);
+	size_t line = 0;
 
-	int ret;
-	char* line = NULL;   /* current line */
-	size_t line_len = 0; /* length of current line */
+	while ( p < end && isdigit((unsigned char)*p) ){
+		line = line * 10 + (*p++ - '0');
+	}
 
-	size_t line_nr = 0;
-	ssize_t n;
+	return line;
+}
 
-	int emit_source; /* whenever to emit the sourceline or not (eg #include should not be emitted) */
+/**
+ * Get the piece type of a directive which is evaluated when assembling the
+ * translation unit, or SPAN if the directive is passed through as-is.
+ */
+static include_cache::piece::type_t directive_type(const char* cmd, const char* end){
+	static const struct {
+		const char* name;
+		include_cache::piece::type_t type;
+	} table[] = {
+		{"version", include_cache::piece::VERSION},
+		{"define",  include_cache::piece::DEFINE},
+		{"undef",   include_cache::piece::UNDEF},
+		{"if",      include_cache::piece::IF},
+		{"ifdef",   include_cache::piece::IFDEF},
+		{"ifndef",  include_cache::piece::IFNDEF},
+		{"elif",    include_cache::piece::ELIF},
+		{"else",    include_cache::piece::ELSE},
+		{"endif",   include_cache::piece::ENDIF},
+		{NULL,      include_cache::piece::SPAN}
+	};
+
+	for ( int i = 0; table[i].name; i++ ){
+		if ( is_directive(cmd, end, table[i].name) ){
+			return table[i].type;
+		}
+	}
 
-	assert(ep);
-	assert(pass);
-	assert(fp);
+	return include_cache::piece::SPAN;
+}
 
-	/* get handle to current file */
-	path_handle_t path_handle;
-	if ( ( ret = glslfx::path_store(filename, path_handle) ) != 0 ){
-		return ret;
+static bool is_conditional(include_cache::piece::type_t type){
+	switch ( type ){
+		case include_cache::piece::IF:
+		case include_cache::piece::IFDEF:
+		case include_cache::piece::IFNDEF:
+		case include_cache::piece::ELIF:
+		case include_cache::piece::ELSE:
+		case include_cache::piece::ENDIF:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/**
+ * Append a piece to a scanned file.
+ */
+static void add_piece(include_cache::entry* dst, include_cache::piece::type_t type, size_t offset, size_t size, unsigned int line, unsigned int lines = 1){
+	if ( size == 0 ){
+		return;
 	}
 
+	include_cache::piece tmp;
+	tmp.type = type;
+	tmp.offset = offset;
+	tmp.size = size;
+	tmp.line = line;
+	tmp.lines = lines;
+	dst->pieces.push_back(tmp);
+}
+
+/**
+ * Scan a file into pieces. The file is scanned line by line directly from
+ * the mapping and only preprocessor lines are inspected, all other lines are
+ * referenced in runs as large as possible. Includes are only recorded, they
+ * are expanded when the translation unit is assembled. Each span records
+ * which lines it covers so the origin of every line of the unit is known
+ * without writing #line directives. The scan is independent of the unit so
+ * it can be cached and shared by all passes.
+ */
+static int source_file(const std::string& filename,
+					   include_cache::entry* dst,
+					   glslfx::log_sink* log){
+
+	enum {
+		GUARD_START,  /* nothing but comments seen yet */
+		GUARD_IFNDEF, /* seen #ifndef X */
+		GUARD_OPEN,   /* seen #ifndef X / #define X */
+		GUARD_CLOSED, /* seen the matching #endif */
+		GUARD_NONE    /* not guarded */
+	} guard = GUARD_START;
+
+	int ret;
+	const char* data = dst->file->data();    /* start of file */
+	const char* p = data;                     /* start of current line */
+	const char* end = p + dst->file->size();  /* end of file */
+	const char* run = p;                      /* start of current run of unchanged lines */
+
+	size_t line_nr = 0;
+	size_t run_line = 1;                      /* line of the first line in the run */
+
+	int depth = 0;           /* conditional nesting */
+	bool in_comment = false; /* inside a block comment */
+	std::string macro;       /* candidate include guard */
+
+	dst->once = false;
+
 	/* process each line */
-	while ( ( n = getline(&line, &line_len, fp) ) != -1 ){
-		char ch = *line;
-		emit_source = 1;
+	while ( p < end ){
+		const char* eol = (const char*)memchr(p, '\n', end - p);
+		const char* next = eol ? eol + 1 : end;
+		if ( !eol ){
+			eol = end;
+		}
+
 		line_nr++;
 
 		/* look for preprocessor commands */
-		if ( ch == '#' ){
-			const char* cmd = strchr_fun(line, isalpha);
-			int emit_line = 0;
-
-			/* include new file */
-			if ( strncmp(cmd, "include", 7) == 0 ){
-				char* refpath = NULL;
-				std::string path;
-				FILE* inc = NULL;
-
-				/* skip source emit */
-				emit_source = 0;
-
-				/* get the path */
-				if ( ( ret = get_include(cmd, &refpath) ) != 0 ){
-					free(line);
-					return ret;
+		const char* cmd = in_comment ? NULL : get_directive(p, eol);
+
+		if ( !cmd ){
+			/* code outside the guard means the guard doesn't cover the file */
+			if ( !is_blank(p, eol, in_comment) && guard != GUARD_OPEN ){
+				guard = GUARD_NONE;
+			}
+
+			p = next;
+			continue;
+		}
+
+		/* include new file */
+		if ( is_directive(cmd, eol, "include") ){
+			const char* refpath;
+			size_t size;
+
+			/* get the path */
+			if ( ( ret = get_include(cmd, eol, &refpath, &size) ) != 0 ){
+				if ( log ){
+					log->format(line_nr, filename, SEVERITY_ERROR, "", "malformed #include directive");
 				}
+				return ret;
+			}
+
+			/* lines preceding the include (the include itself is not emitted) */
+			add_piece(dst, include_cache::piece::SPAN, run - data, p - run, run_line, line_nr - run_line);
+			run = next;
+			run_line = line_nr + 1;
+
+			/* the include is resolved and expanded later */
+			add_piece(dst, include_cache::piece::INCLUDE, refpath - data, size, line_nr);
+		}
+
+		/* the source sets its own line numbers, keep counting from there (the
+		 * line following "#line N" is line N). The directive is removed as
+		 * the driver would otherwise report lines which doesn't match the
+		 * line map. */
+		else if ( is_directive(cmd, eol, "line") ){
+			add_piece(dst, include_cache::piece::SPAN, run - data, p - run, run_line, line_nr - run_line);
+			run = next;
+			run_line = get_line(cmd, eol);
+			line_nr = run_line - 1;
+		}
+
+		/* the pragma is left in the source, unknown pragmas are ignored by the driver */
+		else if ( is_directive(cmd, eol, "pragma") ){
+			std::string tmp;
+			get_identifier(cmd, eol, tmp);
+			if ( tmp == "once" ){
+				dst->once = true;
+			}
+		}
 
-				/* resole path and try to open it */
-				path = ep->resolve_path(refpath);
-				inc = fopen(path.c_str(), "r");
-				free(refpath);
+		/* directives evaluated when the unit is assembled */
+		else {
+			include_cache::piece::type_t type = directive_type(cmd, eol);
 
-				/* check if file exists */
-				if ( !inc ){
-					log->format(line_nr, 0, filename.c_str(), "error", "%s: No such file or directory", path.c_str());
-					free(line);
+			if ( type != include_cache::piece::SPAN ){
+				add_piece(dst, include_cache::piece::SPAN, run - data, p - run, run_line, line_nr - run_line);
+				add_piece(dst, type, p - data, next - p, line_nr);
+				run = next;
+				run_line = line_nr + 1;
+			}
+		}
+
+		/* track conditionals to detect classic include guards */
+		if ( is_directive(cmd, eol, "if") || is_directive(cmd, eol, "ifdef") || is_directive(cmd, eol, "ifndef") ){
+			depth++;
+		} else if ( is_directive(cmd, eol, "endif") ){
+			depth--;
+		}
 
-					return ENOENT;
+		switch ( guard ){
+			case GUARD_START:
+				if ( is_directive(cmd, eol, "ifndef") ){
+					get_identifier(cmd, eol, macro);
+					guard = GUARD_IFNDEF;
+				} else if ( !is_directive(cmd, eol, "pragma") ){
+					guard = GUARD_NONE;
 				}
+				break;
 
-				/* write new line marker (cannot do it for the root source since it expects #version to
-				 * be the first line of the file */
+			case GUARD_IFNDEF:
 				{
-					path_handle_t inc_handle;
-					if ( ( ret = glslfx::path_store(path, inc_handle) ) != 0 ){
-						return ret;
+					std::string tmp;
+					get_identifier(cmd, eol, tmp);
+					guard = ( is_directive(cmd, eol, "define") && tmp == macro ) ? GUARD_OPEN : GUARD_NONE;
+				}
+				break;
+
+			case GUARD_OPEN:
+				if ( depth == 0 ){
+					guard = GUARD_CLOSED;
+				} else if ( depth == 1 && ( is_directive(cmd, eol, "else") || is_directive(cmd, eol, "elif") ) ){
+					/* the other branch is used when the macro is defined */
+					guard = GUARD_NONE;
+				}
+				break;
+
+			case GUARD_CLOSED:
+				guard = GUARD_NONE;
+				break;
+
+			case GUARD_NONE:
+				break;
+		}
+
+		p = next;
+	}
+
+	/* remaining lines */
+	add_piece(dst, include_cache::piece::SPAN, run - data, end - run, run_line, line_nr - run_line + 1);
+
+	dst->lines = line_nr;
+	dst->guard = ( guard == GUARD_CLOSED && !macro.empty() ) ? macro : "";
+	return 0;
+}
+
+int glslfx::include_store(include_cache* cache,
+						  const std::string& filename,
+						  mapped_file* file,
+						  const include_cache::entry** dst,
+						  glslfx::log_sink* log){
+
+	include_cache::entry* tmp = new include_cache::entry;
+	int ret;
+
+	tmp->file = file;
+	tmp->id = file->id();
+	tmp->hash = glslfx::hash(file->data(), file->size());
+
+	if ( ( ret = source_file(filename, tmp, log) ) != 0 ){
+		delete tmp->file;
+		delete tmp;
+		return ret;
+	}
+
+	*dst = cache->store(filename, tmp);
+	return 0;
+}
+
+/**
+ * Get the scanned file, either from the include cache or by reading and
+ * scanning it (in which case it is stored in the cache).
+ */
+static int lookup(const effect* ep,
+				  const std::string& filename,
+				  const include_cache::entry** dst,
+				  glslfx::log_sink* log){
+
+	include_cache* cache = ep->includes();
+	mapped_file* file;
+	int ret;
+
+	assert(dst);
+
+	/* reuse earlier scan */
+	if ( ( *dst = cache->find(filename, ep->files()) ) ){
+		return 0;
+	}
+
+	/* try to open file */
+	file = new mapped_file;
+	if ( ( ret = file->open(ep->files(), filename) ) != 0 ){
+		delete file;
+		return ret;
+	}
+
+	return include_store(cache, filename, file, dst, log);
+}
+
+/**
+ * Record that a unit used a file, a file can be expanded several times if
+ * it isn't guarded.
+ */
+static void add_dependency(std::vector<pass::dependency>* deps, const std::string& filename, uint64_t hash){
+	if ( !deps ){
+		return;
+	}
+
+	for ( std::vector<pass::dependency>::const_iterator it = deps->begin(); it != deps->end(); ++it ){
+		if ( it->path == filename ){
+			return;
+		}
+	}
+
+	pass::dependency tmp;
+	tmp.path = filename;
+	tmp.hash = hash;
+	deps->push_back(tmp);
+}
+
+/**
+ * State of a conditional (#if ... #endif) while a unit is assembled.
+ */
+typedef struct {
+	bool parent;    /* enclosing region is live */
+	bool taken;     /* a branch has been taken */
+	bool live;      /* current branch is live */
+	bool seen_else; /* #else has been seen */
+	bool deferred;  /* left to the driver, all branches are kept */
+} conditional;
+
+/**
+ * State of a translation unit (the source of a single shader) while it is
+ * assembled.
+ */
+typedef struct {
+	source_list* out;
+	const std::map<std::string, std::string>* defines; /* defines supplied by the pass */
+	glslfx::macro_map macros;            /* macros defined so far */
+	std::vector<conditional> cond;       /* open conditionals, innermost last */
+	unsigned int deferred;               /* number of open deferred conditionals */
+	std::vector<std::string> stack;      /* files currently being expanded, outermost first */
+	std::set<std::string> skip;          /* files which must not be expanded again */
+	std::map<std::string, std::string> guarded; /* include guards of files expanded so far */
+	std::vector<pass::dependency>* deps; /* files expanded into the unit (may be NULL) */
+} unit;
+
+/**
+ * Append source to the unit and record where its lines came from.
+ */
+static void emit(unit& tu, const char* ptr, size_t size, unsigned int handle, unsigned int line, unsigned int lines){
+	tu.out->append(ptr, size);
+	tu.out->lines().append(handle, line, lines);
+}
+
+/**
+ * Tell if the current region of the unit is live, eg. not inside a false
+ * conditional.
+ */
+static bool is_live(const unit& tu){
+	return tu.cond.empty() || tu.cond.back().live;
+}
+
+/**
+ * Tell if a macro is known to be defined.
+ */
+static bool is_defined(const unit& tu, const std::string& name){
+	glslfx::macro_map::const_iterator it = tu.macros.find(name);
+	return it != tu.macros.end() && !it->second.uncertain;
+}
+
+/**
+ * Define the macros the driver predefines which follows from the #version
+ * directive of the root source (or its absence). Other predefined macros,
+ * eg. extensions, are unknown and conditionals using them are deferred.
+ */
+static void predefine(unit& tu, const include_cache::entry* root){
+	typedef std::vector<include_cache::piece>::const_iterator iterator;
+	unsigned int version = 110;
+	std::string profile;
+
+	for ( iterator it = root->pieces.begin(); it != root->pieces.end(); ++it ){
+		if ( it->type != include_cache::piece::VERSION ){
+			continue;
+		}
+
+		const char* line = root->file->data() + it->offset;
+		const char* end = line + it->size;
+		const char* p = skip_space(get_directive(line, end) + 7, end);
+
+		version = 0;
+		while ( p < end && isdigit((unsigned char)*p) ){
+			version = version * 10 + (*p++ - '0');
+		}
+
+		p = skip_space(p, end);
+		const char* sp = p;
+		while ( p < end && isalpha((unsigned char)*p) ){
+			p++;
+		}
+		profile.assign(sp, p - sp);
+		break;
+	}
+
+	glslfx::macro tmp;
+	tmp.function = false;
+	tmp.uncertain = false;
+
+	char buf[16];
+	snprintf(buf, sizeof(buf), "%u", version);
+	tmp.value = buf;
+	tu.macros["__VERSION__"] = tmp;
+
+	tmp.value = "1";
+	if ( profile == "es" || version == 100 ){
+		tu.macros["GL_ES"] = tmp;
+	} else if ( version >= 150 ){
+		/* defined by all implementations, GL_compatibility_profile depends
+		 * on the driver */
+		tu.macros["GL_core_profile"] = tmp;
+	}
+}
+
+/**
+ * Store the macro of a #define line.
+ */
+static void define_macro(unit& tu, const char* cmd, const char* end){
+	std::string name;
+	glslfx::macro tmp;
+	const char* p = cmd;
+
+	get_identifier(cmd, end, name);
+
+	/* locate the end of the macro name */
+	while ( p < end && isalpha((unsigned char)*p) ) p++;
+	p = skip_space(p, end);
+	while ( p < end && (isalnum((unsigned char)*p) || *p == '_') ) p++;
+
+	/* function-like macros has the parameter list directly after the name */
+	tmp.function = p < end && *p == '(';
+	if ( tmp.function ){
+		const char* close = (const char*)memchr(p, ')', end - p);
+		p = close ? close + 1 : end;
+	}
+
+	/* inside a deferred conditional the definition may not be used */
+	tmp.uncertain = tu.deferred > 0;
+	tmp.value.assign(skip_space(p, end), end);
+	tu.macros[name] = tmp;
+}
+
+/**
+ * Evaluate the condition of an #if, #ifdef, #ifndef or #elif.
+ * @return 0 if successful, EXPR_DEFERRED if only the driver can evaluate
+ *         it or E_PARSE_ERROR.
+ */
+static int evaluate(const unit& tu, const include_cache::piece& piece, const char* cmd, const char* end, bool& dst){
+	glslfx::macro_map::const_iterator it;
+	std::string name;
+	long value;
+	int ret;
+
+	switch ( piece.type ){
+		case include_cache::piece::IFDEF:
+		case include_cache::piece::IFNDEF:
+			get_identifier(cmd, end, name);
+			if ( name.empty() ){
+				return E_PARSE_ERROR;
+			}
+
+			it = tu.macros.find(name);
+			if ( ( it != tu.macros.end() && it->second.uncertain ) ||
+			     ( it == tu.macros.end() && name != "__LINE__" && glslfx::is_reserved_macro(name) ) ){
+				return glslfx::EXPR_DEFERRED;
+			}
+
+			dst = ( it != tu.macros.end() || name == "__LINE__" ) == ( piece.type == include_cache::piece::IFDEF );
+			return 0;
+
+		case include_cache::piece::IF:
+		case include_cache::piece::ELIF:
+			while ( cmd < end && isalpha((unsigned char)*cmd) ) cmd++;
+			if ( ( ret = glslfx::eval_expression(cmd, end, tu.macros, piece.line, value) ) != 0 ){
+				return ret;
+			}
+			dst = value != 0;
+			return 0;
+
+		default:
+			return E_PARSE_ERROR;
+	}
+}
+
+/**
+ * Evaluate a directive piece. Conditionals which only the driver can
+ * evaluate are passed on to the driver along with all their branches.
+ */
+static int directive(unit& tu,
+					 const std::string& filename,
+					 path_handle_t handle,
+					 const include_cache::entry* entry,
+					 const include_cache::piece& piece,
+					 glslfx::log_sink* log){
+
+	const char* line = entry->file->data() + piece.offset;
+	const char* end = line + piece.size;
+	const char* cmd;
+	const char* error = NULL;
+	bool live = is_live(tu);
+	bool value = false;
+	std::string name;
+	int ret;
+
+	/* exclude the newline */
+	while ( end > line && (end[-1] == '\n' || end[-1] == '\r') ){
+		end--;
+	}
+	cmd = get_directive(line, end);
+
+	switch ( piece.type ){
+		case include_cache::piece::DEFINE:
+			if ( live ){
+				define_macro(tu, cmd, end);
+			}
+			break;
+
+		case include_cache::piece::UNDEF:
+			if ( live ){
+				get_identifier(cmd, end, name);
+
+				/* inside a deferred conditional the macro may be kept */
+				if ( tu.deferred > 0 ){
+					glslfx::macro& cur = tu.macros[name];
+					cur.function = false;
+					cur.uncertain = true;
+				} else {
+					tu.macros.erase(name);
+				}
+			}
+			break;
+
+		case include_cache::piece::IF:
+		case include_cache::piece::IFDEF:
+		case include_cache::piece::IFNDEF:
+			{
+				conditional tmp;
+				tmp.deferred = false;
+
+				/* conditions inside dead regions are never evaluated */
+				if ( live && ( ret = evaluate(tu, piece, cmd, end, value) ) != 0 ){
+					if ( ret != glslfx::EXPR_DEFERRED ){
+						error = "invalid preprocessor condition";
+						break;
 					}
-					stream << "#line 1 " << inc_handle << std::endl;
+
+					emit(tu, line, piece.size, handle, piece.line, 1);
+					tmp.deferred = true;
+					value = true;
+					tu.deferred++;
 				}
 
-				/* process sourcefile */
-				if ( ( ret = source_file(ep, pass, stream, path, inc, log) ) != 0 ){
-					free(line);
-					return ret;
+				tmp.parent = live;
+				tmp.live = live && value;
+				tmp.taken = tmp.live;
+				tmp.seen_else = false;
+				tu.cond.push_back(tmp);
+			}
+			break;
+
+		case include_cache::piece::ELIF:
+			if ( tu.cond.empty() || tu.cond.back().seen_else ){
+				error = "#elif without #if";
+				break;
+			}
+
+			{
+				conditional& cur = tu.cond.back();
+				if ( cur.deferred ){
+					/* the driver picks the branch */
+					emit(tu, line, piece.size, handle, piece.line, 1);
+					cur.live = true;
+				} else if ( cur.parent && !cur.taken ){
+					if ( ( ret = evaluate(tu, piece, cmd, end, value) ) == glslfx::EXPR_DEFERRED ){
+						/* earlier branches are already dropped, the driver
+						 * sees this branch as the start of the conditional */
+						tu.out->append_text("#if" + std::string(cmd + 4, end) + "\n");
+						tu.out->lines().append(handle, piece.line, 1);
+						cur.deferred = true;
+						cur.live = true;
+						tu.deferred++;
+					} else if ( ret != 0 ){
+						error = "invalid preprocessor condition";
+						break;
+					} else {
+						cur.live = value;
+						cur.taken = value;
+					}
+				} else {
+					cur.live = false;
 				}
+			}
+			break;
+
+		case include_cache::piece::ELSE:
+			if ( tu.cond.empty() || tu.cond.back().seen_else ){
+				error = "#else without #if";
+				break;
+			}
+
+			{
+				conditional& cur = tu.cond.back();
+				if ( cur.deferred ){
+					emit(tu, line, piece.size, handle, piece.line, 1);
+					cur.live = true;
+				} else {
+					cur.live = cur.parent && !cur.taken;
+				}
+				cur.taken = true;
+				cur.seen_else = true;
+			}
+			break;
+
+		case include_cache::piece::ENDIF:
+			if ( tu.cond.empty() ){
+				error = "#endif without #if";
+				break;
+			}
 
-				emit_line = 1;
+			if ( tu.cond.back().deferred ){
+				emit(tu, line, piece.size, handle, piece.line, 1);
+				tu.deferred--;
 			}
 
-			/* emit a new #line */
-			if ( emit_line ){
-				stream << "#line " << line_nr << " " << path_handle << std::endl;
+			tu.cond.pop_back();
+			break;
+
+		default:
+			break;
+	}
+
+	if ( error ){
+		if ( log ){
+			log->format(piece.line, filename, SEVERITY_ERROR, "", "%s", error);
+		}
+		return E_PARSE_ERROR;
+	}
+
+	return 0;
+}
+
+/**
+ * Write the defines supplied by the pass. The generated lines have a run of
+ * their own in the line map, attributed to the "<defines>" path with one
+ * line per define in order of their names, so driver messages about them
+ * are not reported against the source they are inserted into.
+ */
+static int emit_defines(const effect* ep, unit& tu){
+	typedef std::map<std::string, std::string>::const_iterator iterator;
+	path_handle_t handle;
+	int ret;
+
+	if ( tu.defines->empty() ){
+		return 0;
+	}
+
+	if ( ( ret = ep->path_store("<defines>", handle) ) != 0 ){
+		return ret;
+	}
+
+	std::string text;
+
+	for ( iterator it = tu.defines->begin(); it != tu.defines->end(); ++it ){
+		text += "#define " + it->first + " " + it->second + "\n";
+	}
+
+	tu.out->append_text(text);
+	tu.out->lines().append(handle, 1, tu.defines->size());
+	return 0;
+}
+
+/**
+ * Expand a scanned file into the translation unit, evaluating conditionals
+ * and recursively expanding includes in live regions. Includes in dead
+ * regions are never looked up. Files which are marked #pragma once or whose
+ * include guard is already defined are skipped without touching the file.
+ */
+static int expand(const effect* ep,
+				  unit& tu,
+				  const std::string& filename,
+				  const include_cache::entry* entry,
+				  bool root,
+				  glslfx::log_sink* log){
+
+	typedef std::vector<include_cache::piece>::const_iterator iterator;
+	const char* data = entry->file->data();
+	size_t depth = tu.cond.size();
+	path_handle_t handle;
+	int ret;
+
+	/* guard already defined, the file would expand to nothing */
+	if ( !entry->guard.empty() ){
+		tu.guarded[filename] = entry->guard;
+		if ( is_defined(tu, entry->guard) ){
+			return 0;
+		}
+	}
+
+	/* a file expanded in a deferred conditional may not be used by the
+	 * driver, so it is expanded again if included later on */
+	if ( entry->once && tu.deferred == 0 ){
+		tu.skip.insert(filename);
+	}
+
+	add_dependency(tu.deps, filename, entry->hash);
+
+	/* handles in the line map are local to the effect */
+	if ( ( ret = ep->path_store(filename, handle) ) != 0 ){
+		return ret;
+	}
+
+	tu.stack.push_back(filename);
+
+	for ( iterator it = entry->pieces.begin(); it != entry->pieces.end(); ++it ){
+		/* conditionals are always evaluated to track nesting */
+		if ( is_conditional(it->type) ){
+			if ( ( ret = directive(tu, filename, handle, entry, *it, log) ) != 0 ){
+				return ret;
 			}
+			continue;
+		}
+
+		if ( !is_live(tu) ){
+			continue;
+		}
+
+		switch ( it->type ){
+			case include_cache::piece::SPAN:
+				emit(tu, data + it->offset, it->size, handle, it->line, it->lines);
+				break;
+
+			case include_cache::piece::VERSION:
+				emit(tu, data + it->offset, it->size, handle, it->line, 1);
+
+				/* defines supplied by the pass goes directly after #version */
+				if ( root && ( ret = emit_defines(ep, tu) ) != 0 ){
+					return ret;
+				}
+				break;
+
+			case include_cache::piece::DEFINE:
+			case include_cache::piece::UNDEF:
+				/* macros are kept in the source as the driver needs them as well */
+				emit(tu, data + it->offset, it->size, handle, it->line, 1);
+				if ( ( ret = directive(tu, filename, handle, entry, *it, log) ) != 0 ){
+					return ret;
+				}
+				break;
+
+			case include_cache::piece::INCLUDE:
+				{
+					std::string path = ep->resolve_path(std::string(data + it->offset, it->size));
+					const include_cache::entry* inc = NULL;
+
+					/* already included once, skip without touching the file */
+					if ( tu.skip.count(path) > 0 ){
+						break;
+					}
+
+					/* include guard still defined, skip without touching the file */
+					std::map<std::string, std::string>::const_iterator guard = tu.guarded.find(path);
+					if ( guard != tu.guarded.end() && is_defined(tu, guard->second) ){
+						break;
+					}
+
+					/* including a file which is being expanded would recurse forever */
+					if ( std::find(tu.stack.begin(), tu.stack.end(), path) != tu.stack.end() ){
+						if ( log ){
+							std::string chain;
+							for ( std::vector<std::string>::iterator jt = tu.stack.begin(); jt != tu.stack.end(); ++jt ){
+								chain += *jt + " -> ";
+							}
+							log->format(it->line, filename, SEVERITY_ERROR, "", "include cycle: %s%s", chain.c_str(), path.c_str());
+						}
+						return E_INCLUDE_CYCLE;
+					}
+
+					if ( ( ret = lookup(ep, path, &inc, log) ) != 0 ){
+						if ( ret == ENOENT && log ){
+							log->format(it->line, filename, SEVERITY_ERROR, "", "%s: No such file or directory", path.c_str());
+						}
+
+						/* watched by the reloader in case it is created */
+						add_dependency(tu.deps, path, 0);
+						return ret;
+					}
+
+					if ( ( ret = expand(ep, tu, path, inc, false, log) ) != 0 ){
+						return ret;
+					}
+				}
+				break;
+
+			default:
+				break;
 		}
+	}
 
-		/* output line */
-		if ( emit_source ){
-			stream << line;
+	/* conditionals may not span files */
+	if ( tu.cond.size() != depth ){
+		if ( log ){
+			log->format(entry->lines, filename, SEVERITY_ERROR, "", "unterminated conditional directive");
 		}
+		return E_PARSE_ERROR;
 	}
 
-	free(line);
+	/* included file might not have ended with a newline */
+	if ( !root && !tu.out->ends_with_newline() ){
+		tu.out->append("\n", 1);
+	}
 
+	tu.stack.pop_back();
 	return 0;
 }
 
+/**
+ * Tell if a scanned file has a #version directive.
+ */
+static bool has_version(const include_cache::entry* entry){
+	typedef std::vector<include_cache::piece>::const_iterator iterator;
+
+	for ( iterator it = entry->pieces.begin(); it != entry->pieces.end(); ++it ){
+		if ( it->type == include_cache::piece::VERSION ){
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static int source(const effect* ep,
-		   const pass* pass,
 		   const std::string& filename,
-		   FILE* fp,
-		   std::string& dst,
-		   glslfx::log* log){
-
-	std::stringstream stream;
+		   const std::map<std::string, std::string>& defines,
+		   source_list& dst,
+		   std::vector<pass::dependency>* deps,
+		   glslfx::log_sink* log){
+
+	typedef std::map<std::string, std::string>::const_iterator iterator;
+	const include_cache::entry* src = NULL;
+	unit tu;
 	int ret;
 
 	/* assert parameters */
 	assert(ep);
-	assert(pass);
-	assert(fp);
 
-	if ( ( ret = source_file(ep, pass, stream, filename, fp, log) ) != 0 ){
+	if ( deps ){
+		deps->clear();
+	}
+
+	if ( ( ret = lookup(ep, filename, &src, log) ) != 0 ){
+		add_dependency(deps, filename, 0);
 		return ret;
 	}
 
-	dst = stream.str();
-	return 0;
+	dst.clear();
+	tu.out = &dst;
+	tu.defines = &defines;
+	tu.deps = deps;
+	tu.deferred = 0;
+
+	predefine(tu, src);
+
+	/* defines supplied by the pass are visible to all conditionals */
+	for ( iterator it = defines.begin(); it != defines.end(); ++it ){
+		glslfx::macro tmp;
+		tmp.value = it->second;
+		tmp.function = false;
+		tmp.uncertain = false;
+		tu.macros[it->first] = tmp;
+	}
+
+	/* without #version the defines goes first */
+	if ( !has_version(src) && ( ret = emit_defines(ep, tu) ) != 0 ){
+		return ret;
+	}
+
+	return expand(ep, tu, filename, src, true, log);
 }
 
-static int parse_log(GLuint target, glslfx::log* log){
+
+/**
+ * Parse the info log of a shader or program and write the messages to log.
+ * Drivers report a string index and a line within that string, if the
+ * source is given the pair is translated back to the original file and line
+ * using its line map (handles are resolved through the path table of ep).
+ */
+static int parse_log(const effect* ep, GLuint target, const source_list* src, glslfx::log_sink* log){
 	GLint size;
 
 	void (*query_func)(GLuint target, GLenum pname, GLint* param) = NULL;
@@ -288,105 +1117,79 @@ static int parse_log(GLuint target, glslfx::log* log){
 		return 0;
 	}
 
-	/* allocate log buffer */
-	std::auto_ptr<char> buffer((char*)malloc(size));
-	if ( !buffer.get() ){
-		return ENOMEM;
-	}
-
 	/* get log from driver */
-	get_func(target, size, &size, buffer.get());
+	std::vector<char> buffer(size);
+	get_func(target, size, &size, &buffer[0]);
+
+	/* all messages in a log has the same format */
+	const info_parser parse = select_info_parser(get_vendor());
+
+	/* push messages to log, lines are parsed in place */
+	const char* p = &buffer[0];
+	const char* end = p + size;
+	while ( p < end ){
+		const char* eol = (const char*)memchr(p, '\n', end - p);
+		const char* next = eol ? eol + 1 : end;
+		if ( !eol ){
+			eol = end;
+		}
 
-	/* push messages to log */
-	char* ctx = NULL;
-	char* line = strtok_r(buffer.get(), "\n", &ctx);
-	while ( line ){
 		/* hack for some strings which has initial whitespace */
-		while ( *line && isspace(*line) ){
-			line++;
+		while ( p < eol && isspace((unsigned char)*p) ){
+			p++;
+		}
+		while ( eol > p && isspace((unsigned char)eol[-1]) ){
+			eol--;
 		}
 
 		/* if the line was only whitespace we may skip processing. */
-		if ( !*line ){
-			break;
+		if ( p == eol ){
+			p = next;
+			continue;
 		}
 
-		/* result variables */
-		cmatch res;             /* regexp result */
-		int path_handle;        /* path handle */
-		int line_nr;            /* line number */
-		std::string ref;        /* error number */
-		std::string tag;        /* error or warning */
-		std::string message;    /* actual messsage */
-		bool succeded = false;  /* whenever the parsing succeded or not */
-
-		/* need to do different parsing depending on which vendor is used since
-		 * they have different styles of the messages. */
-		switch ( get_vendor() ){
-			case VENDOR_ATI:
-				/* ERROR: 0:19: error(#160) Cannot convert from '4-component vector of float' to 'default out mediump 2-component vector of float' */
-				{
-					/*                     TAG          line_nr         tag           ref              message       */
-					regex rx("(?:[A-Z]+)\\: ([0-9]+)\\:([0-9]+)\\: ([a-zA-Z]+)[(]([a-zA-Z0-9#]+)[)] (.+)");
-					if ( !regex_search(line, res, rx) ){
-						break;
-					}
-
-					path_handle = atoi(res[1].str().c_str());
-					line_nr = atoi(res[2].str().c_str());
-					tag = res[3];
-					ref = res[4];
-					message = res[5];
-					succeded = true;
-				}
-				break;
-
-			case VENDOR_NVIDIA:
-				/* 0(5) : warning C7533: global variable gl_ModelViewProjectionMatrix is deprecated after version 120 */
-				{
-					/*                       line_nr          tag           ref             message      */
-					regex rx("0[(]([0-9]+)[)] \\: ([a-zA-Z]+) ([a-zA-Z0-9]+)\\: (.+)");
-					if ( !regex_search(line, res, rx) ){
-						break;
-					}
+		info_message msg;
+		if ( parse(p, eol, msg) ){
+			const severity_t severity = glslfx::log::parse_severity(string_view(msg.severity, msg.severity_len));
+			std::string path = "<unknown>";
+			unsigned int line_nr = msg.line;
+			unsigned int handle;
+			unsigned int src_line;
+
+			/* the sink only counts the message */
+			if ( !log->wants_text(severity) ){
+				log->write(0, string_view(), severity, string_view(), string_view());
+				p = next;
+				continue;
+			}
 
-					path_handle = atoi(res[1].str().c_str());
-					line_nr = atoi(res[2].str().c_str());
-					tag = res[3];
-					ref = res[4];
-					message = res[5];
-					succeded = true;
+			/* lines are counted per string, the line map covers the entire
+			 * source. Lines without an origin are reported as is. */
+			if ( src && src->lines().find(src->first_line(msg.string) + line_nr - 1, handle, src_line) == 0 && handle != line_map::unmapped ){
+				if ( ep->path_retrieve(handle, path) != 0 ){
+					path = "<unknown>";
 				}
-				break;
-
-			case VENDOR_UNKNOWN:
-			case VENDOR_OTHER:
-				break;
-		}
-
-		if ( succeded ){
-			std::string path;
-			if ( glslfx::path_retrieve(path_handle, path) != 0 ){
-				path = "<unknown>";
+				line_nr = src_line;
 			}
-			log->message(line_nr, path, tag, ref, message);
+
+			log->message(line_nr, path, severity,
+						 string_view(msg.ref, msg.ref_len),
+						 string_view(msg.message, msg.message_len));
 		} else {
-			log->generic(line);
+			log->generic(string_view(p, eol - p));
 		}
-		line = strtok_r(NULL, "\n", &ctx);
+
+		p = next;
 	}
 
 	return 0;
 }
 
-static int compile(GLenum target, const std::string& src, GLuint& shader, glslfx::log* log){
-	const char* src_ptr = src.c_str();
-
-	printf("shader source:\n%s\n", src_ptr);
-
-	/* compile */
+static int compile(const effect* ep, GLenum target, source_list& src, GLuint& shader, glslfx::log_sink* log){
+	/* compile, each segment is passed as a separate string so shared
+	 * includes are never copied */
 	shader = glCreateShader(target);
-	glShaderSource(shader, 1, &src_ptr, 0);
+	glShaderSource(shader, src.count(), src.strings(), src.lengths());
 	glCompileShader(shader);
 
 	/* if no log is provided nothing more needs to be done */
@@ -394,12 +1197,13 @@ static int compile(GLenum target, const std::string& src, GLuint& shader, glslfx
 		return 0;
 	}
 
-	return parse_log(shader, log);
+	return parse_log(ep, shader, &src, log);
 }
 
 pass::pass(const effect* ep, const std::string& name)
 	: ep(ep)
 	, _name(name)
+	, _num_variants(0)
 	, _sp(0) {
 
 	_layout.entry = NULL;
@@ -408,7 +1212,11 @@ pass::pass(const effect* ep, const std::string& name)
 }
 
 pass::~pass(){
+	clear_variants();
 
+	if ( _sp != 0 ){
+		ep->shaders()->release(_sp);
+	}
 }
 
 const std::string& pass::name() const {
@@ -442,45 +1250,96 @@ int pass::path(GLenum target, std::string& dst) const {
 	return 0;
 }
 
-int pass::source(GLenum target, std::string& dst) const {
-	entry tmp;
-	int ret;
+int pass::source(GLenum target, source_list& dst, std::vector<dependency>* deps, glslfx::log_sink* log) const {
+	return source(target, _defines, dst, deps, log);
+}
+
+int pass::expand(GLenum target, const define_map& defines, source_list& dst, std::vector<dependency>* deps, glslfx::log_sink* log) const {
+	const_iterator it = _shader.find(target);
 
 	/* search for entry */
-	if ( ( ret = find_entry(target, tmp) ) != 0 ){
+	if ( it == _shader.end() ){
+		return E_NOT_SET;
+	}
+
+	/* baked sources already are expanded, the text stays in the mapping */
+	const baked_stage* baked = it->second.baked;
+	if ( baked && defines.empty() ){
+		dst.clear();
+		dst.append(baked->data, baked->size);
+		dst.lines() = baked->lines;
+		if ( deps ){
+			*deps = baked->deps;
+		}
+		return 0;
+	}
+
+	/* resolve path and read (or reuse) its expansion */
+	std::string path = ep->resolve_path(it->second.path);
+	return ::source(ep, path, defines, dst, deps, log);
+}
+
+int pass::source(GLenum target, const define_map& defines, source_list& dst, std::vector<dependency>* deps, glslfx::log_sink* log) const {
+	int ret;
+
+	if ( ( ret = expand(target, defines, dst, deps, log) ) != 0 ){
 		return ret;
 	}
 
-	/* resolve path and try to open it */
-	std::string path = ep->resolve_path(tmp.path);
-	FILE* fp = fopen(path.c_str(), "r");
+	if ( ep->minify() != MINIFY_NONE ){
+		source_list minified;
+		minify(dst, ep->minify(), minified);
+		dst.swap(minified);
+	}
+
+	return 0;
+}
+
+int pass::source(GLenum target, std::string& dst) const {
+	include_cache::scope scope(ep->includes());
+	source_list tmp;
+	int ret;
 
-	/* check if the file exists */
-	if ( !fp ){
-		return ENOENT;
+	if ( ( ret = source(target, tmp, NULL, NULL) ) != 0 ){
+		return ret;
 	}
 
-	/* read source */
-	return ::source(ep, this, path, fp, dst, 0);
+	tmp.str(dst);
+	return 0;
 }
 
 GLint pass::program() const {
-	/* not implemented */
-	return 0;
+	return _sp;
 }
 
 void pass::bind(const GLvoid* vertices) const {
+	use(_sp, vertices);
+}
+
+int pass::bind(const GLvoid* vertices, variant_key key){
+	GLuint sp;
+	int ret;
+
+	if ( ( ret = variant(key, sp) ) != 0 ){
+		return ret;
+	}
+
+	use(sp, vertices);
+	return 0;
+}
+
+void pass::use(GLuint sp, const GLvoid* vertices) const {
 	static const pass* current = NULL;
 
 	if ( current ){
 		current->unbind();
 	}
 
-	glUseProgram(_sp);
+	glUseProgram(sp);
 
 
-	GLint mv = glGetUniformLocation(_sp, "mv");
-	GLint p = glGetUniformLocation(_sp, "p");
+	GLint mv = glGetUniformLocation(sp, "mv");
+	GLint p = glGetUniformLocation(sp, "p");
 
 	float buf[16];
 
@@ -514,37 +1373,427 @@ void pass::set_path(GLenum target, const std::string& path){
 	entry tmp;
 	tmp.path = path;
 	tmp.shader = 0;
+	tmp.baked = NULL;
 
 	_shader.insert(pair(target, tmp));
 }
 
-int pass::compile(log* log){
-	int ret;
+int pass::compile(log_sink* log){
+	include_cache::scope scope(ep->includes());
+	source_list* src = new source_list[_shader.size()];
+	std::vector<source_list*> tmp;
+	int ret = 0;
 
-	/* compile all shaders */
+	/* preprocess all shaders */
 	for ( iterator it = _shader.begin(); it != _shader.end(); ++it ){
-		std::string src;
+		source_list* cur = &src[tmp.size()];
+		tmp.push_back(cur);
 
-		if ( ( ret = source(it->first, src) ) != 0 ){
-			return ret;
+		if ( ( ret = source(it->first, *cur, &it->second.deps, log) ) != 0 ){
+			break;
+		}
+	}
+
+	if ( ret == 0 ){
+		ret = submit(tmp, log);
+	}
+
+	delete[] src;
+	return ret;
+}
+
+int pass::build(const std::vector<source_list*>& src, std::vector<GLuint>& shader, GLuint& sp, GLint& status, log_sink* log) const {
+	shader_cache* cache = ep->shaders();
+	uint64_t key = hash_seed;
+	int ret = 0;
+	size_t n = 0;
+
+	sp = 0;
+	status = GL_FALSE;
+	shader.clear();
+
+	/* compile all shaders, reusing shaders with identical sources */
+	for ( const_iterator it = _shader.begin(); it != _shader.end(); ++it, ++n ){
+		const GLenum target = it->first;
+		const uint64_t h = src[n]->hash(hash_seed);
+		GLuint tmp = cache->shader(target, h);
+
+		if ( tmp == 0 ){
+			ret = ::compile(ep, target, *src[n], tmp, log);
+			cache->add_shader(target, h, tmp);
+		} else if ( log ){
+			/* report the same messages as if it was compiled again */
+			ret = parse_log(ep, tmp, src[n], log);
 		}
 
-		if ( ( ret = ::compile(it->first, src, it->second.shader, log) ) != 0 ){
+		shader.push_back(tmp);
+
+		if ( ret != 0 ){
 			return ret;
 		}
+
+		key = glslfx::hash(&target, sizeof(GLenum), key);
+		key = glslfx::hash(&h, sizeof(uint64_t), key);
+	}
+
+	/* keep attribute locations from the pass program so the layout is
+	 * usable with all variants, the bindings are part of the program */
+	const bool bind_attrib = _sp != 0;
+	if ( bind_attrib ){
+		for ( unsigned int i = 0; i < _layout.n; i++ ){
+			const layout_entry& e = _layout.entry[i];
+			key = glslfx::hash(e.name.data(), e.name.size() + 1, key);
+			key = glslfx::hash(&e.attrib, sizeof(GLint), key);
+		}
+	}
+
+	/* reuse a program with the same set of shaders */
+	if ( ( sp = cache->program(key) ) != 0 ){
+		glGetProgramiv(sp, GL_LINK_STATUS, &status);
+		return log ? parse_log(ep, sp, NULL, log) : 0;
 	}
 
-	_sp = glCreateProgram();
+	sp = glCreateProgram();
 
 	/* attach shaders to program */
-	for ( iterator it = _shader.begin(); it != _shader.end(); ++it ){
-		glAttachShader(_sp, it->second.shader);
+	for ( std::vector<GLuint>::const_iterator it = shader.begin(); it != shader.end(); ++it ){
+		glAttachShader(sp, *it);
+	}
+
+	if ( bind_attrib ){
+		for ( unsigned int i = 0; i < _layout.n; i++ ){
+			const layout_entry& e = _layout.entry[i];
+			if ( e.attrib >= 0 ){
+				glBindAttribLocation(sp, e.attrib, e.name.c_str());
+			}
+		}
 	}
 
 	/* and link */
-	glLinkProgram(_sp);
+	glLinkProgram(sp);
+	glGetProgramiv(sp, GL_LINK_STATUS, &status);
+	cache->add_program(key, sp, shader);
+
+	return log ? parse_log(ep, sp, NULL, log) : 0;
+}
+
+int pass::submit(const std::vector<source_list*>& src, log_sink* log){
+	std::vector<GLuint> shader;
+	GLint status;
+	GLuint sp;
+	int ret;
+
+	/* the current program (if any) stays untouched until the new one has
+	 * been linked */
+	ret = build(src, shader, sp, status, log);
+
+	/* if the program failed and there is a working program it is kept,
+	 * otherwise the new program replaces it (so it can be inspected) */
+	if ( sp == 0 || ( status != GL_TRUE && _sp != 0 ) ){
+		if ( sp != 0 ){
+			ep->shaders()->release(sp);
+		}
+		return ret;
+	}
+
+	size_t n = 0;
+	for ( iterator it = _shader.begin(); it != _shader.end(); ++it, ++n ){
+		it->second.shader = shader[n];
+	}
+
+	if ( _sp != 0 ){
+		ep->shaders()->release(_sp);
+	}
+	_sp = sp;
+
+	/* attribute locations may differ in the new program */
+	for ( unsigned int i = 0; i < _layout.n; i++ ){
+		layout_entry& e = _layout.entry[i];
+		e.attrib = glGetAttribLocation(_sp, e.name.c_str());
+	}
+
+	/* variants are built from the old sources */
+	clear_variants();
 
-	return parse_log(_sp, log);
+	return ret;
+}
+
+int pass::dependencies(GLenum target, std::vector<dependency>& dst) const {
+	const_iterator it = _shader.find(target);
+
+	if ( it == _shader.end() ){
+		return E_NOT_SET;
+	}
+
+	dst = it->second.deps;
+	return 0;
+}
+
+void pass::set_define(const std::string& name, const std::string& value){
+	_defines[name] = value;
+}
+
+void pass::unset_define(const std::string& name){
+	_defines.erase(name);
+}
+
+int pass::add_keyword(const std::string& name){
+	/* already declared */
+	if ( std::find(_keywords.begin(), _keywords.end(), name) != _keywords.end() ){
+		return 0;
+	}
+
+	if ( _keywords.size() >= sizeof(variant_key) * 8 ){
+		return E_OUT_OF_RANGE;
+	}
+
+	_keywords.push_back(name);
+	return 0;
+}
+
+int pass::keyword(const std::string& name, variant_key& dst) const {
+	std::vector<std::string>::const_iterator it = std::find(_keywords.begin(), _keywords.end(), name);
+
+	if ( it == _keywords.end() ){
+		return E_NOT_FOUND;
+	}
+
+	dst = (variant_key)1 << (it - _keywords.begin());
+	return 0;
+}
+
+static size_t variant_slot(pass::variant_key key, size_t size){
+	/* fibonacci hashing, size is a power of two */
+	return (size_t)(key * 2654435761U) & (size - 1);
+}
+
+const pass::variant_entry* pass::find_variant(variant_key key) const {
+	if ( _variants.empty() ){
+		return NULL;
+	}
+
+	for ( size_t i = variant_slot(key, _variants.size()); ; i = (i + 1) & (_variants.size() - 1) ){
+		const variant_entry& cur = _variants[i];
+
+		if ( !cur.used ){
+			return NULL;
+		}
+
+		if ( cur.key == key ){
+			return &cur;
+		}
+	}
+}
+
+void pass::insert_variant(variant_key key, GLuint program){
+	/* keep the load below one half */
+	if ( ( _num_variants + 1 ) * 2 > _variants.size() ){
+		std::vector<variant_entry> old;
+		variant_entry empty = {0, 0, false};
+
+		old.swap(_variants);
+		_variants.assign(old.empty() ? 16 : old.size() * 2, empty);
+		_num_variants = 0;
+
+		for ( std::vector<variant_entry>::const_iterator it = old.begin(); it != old.end(); ++it ){
+			if ( it->used ){
+				insert_variant(it->key, it->program);
+			}
+		}
+	}
+
+	size_t i = variant_slot(key, _variants.size());
+	while ( _variants[i].used ){
+		i = (i + 1) & (_variants.size() - 1);
+	}
+
+	_variants[i].key = key;
+	_variants[i].program = program;
+	_variants[i].used = true;
+	_num_variants++;
+}
+
+void pass::clear_variants(){
+	for ( std::map<uint64_t, GLuint>::iterator it = _variant_program.begin(); it != _variant_program.end(); ++it ){
+		ep->shaders()->release(it->second);
+	}
+
+	_variant_program.clear();
+	_variants.clear();
+	_num_variants = 0;
+}
+
+int pass::variant(variant_key key, GLuint& program, log_sink* log){
+	const variant_entry* cur;
+	int ret;
+
+	if ( !( cur = find_variant(key) ) ){
+		if ( ( ret = prepare_variants(&key, 1, log) ) != 0 ){
+			return ret;
+		}
+
+		cur = find_variant(key);
+		assert(cur);
+	}
+
+	program = cur->program;
+	return 0;
+}
+
+/**
+ * A single shader of a variant to preprocess.
+ */
+typedef struct {
+	const pass* owner;
+	GLenum target;
+	const std::map<std::string, std::string>* defines;
+	source_list src;
+	glslfx::log log;  /* messages are merged in order after all jobs are done */
+	int ret;
+} variant_job;
+
+void pass::preprocess_variant(void* data, size_t index){
+	variant_job* cur = ((variant_job**)data)[index];
+	cur->ret = cur->owner->source(cur->target, *cur->defines, cur->src, NULL, &cur->log);
+}
+
+static bool is_ident_char(char c){
+	return isalnum((unsigned char)c) || c == '_';
+}
+
+/**
+ * Hash a variant source for deduplication. Conditionals are already resolved
+ * by the preprocessor so a keyword macro which isn't referenced elsewhere in
+ * the source cannot affect the program, its definition is left out.
+ */
+static uint64_t variant_hash(const source_list& src, const std::vector<std::string>& keywords, uint64_t seed){
+	std::string text;
+	src.str(text);
+
+	for ( std::vector<std::string>::const_iterator it = keywords.begin(); it != keywords.end(); ++it ){
+		const std::string line = "#define " + *it + " 1\n";
+		const size_t def = text.find(line);
+		bool used = false;
+
+		if ( def == std::string::npos ){
+			continue;
+		}
+
+		for ( size_t pos = text.find(*it); pos != std::string::npos; pos = text.find(*it, pos + 1) ){
+			const size_t end = pos + it->size();
+
+			if ( pos == def + 8 ){
+				continue;
+			}
+			if ( ( pos > 0 && is_ident_char(text[pos-1]) ) || ( end < text.size() && is_ident_char(text[end]) ) ){
+				continue;
+			}
+
+			used = true;
+			break;
+		}
+
+		if ( !used ){
+			text.erase(def, line.size());
+		}
+	}
+
+	return glslfx::hash(text.data(), text.size(), seed);
+}
+
+int pass::prepare_variants(const variant_key* keys, size_t n, log_sink* log){
+	const variant_key valid = _keywords.size() < sizeof(variant_key) * 8 ? ((variant_key)1 << _keywords.size()) - 1 : ~(variant_key)0;
+	include_cache::scope scope(ep->includes());
+	std::vector<variant_key> todo;
+
+	for ( size_t i = 0; i < n; i++ ){
+		if ( keys[i] & ~valid ){
+			return E_OUT_OF_RANGE;
+		}
+
+		if ( !find_variant(keys[i]) && std::find(todo.begin(), todo.end(), keys[i]) == todo.end() ){
+			todo.push_back(keys[i]);
+		}
+	}
+
+	if ( todo.empty() ){
+		return 0;
+	}
+
+	/* macros for each variant */
+	std::vector<define_map> defines(todo.size(), _defines);
+	for ( size_t i = 0; i < todo.size(); i++ ){
+		for ( size_t bit = 0; bit < _keywords.size(); bit++ ){
+			if ( todo[i] & ((variant_key)1 << bit) ){
+				defines[i][_keywords[bit]] = "1";
+			}
+		}
+	}
+
+	/* preprocess all shaders of all variants in parallel */
+	std::vector<variant_job*> jobs;
+	for ( size_t i = 0; i < todo.size(); i++ ){
+		for ( const_iterator it = _shader.begin(); it != _shader.end(); ++it ){
+			variant_job* tmp = new variant_job;
+			tmp->owner = this;
+			tmp->target = it->first;
+			tmp->defines = &defines[i];
+			tmp->ret = 0;
+			jobs.push_back(tmp);
+		}
+	}
+
+	ep->pool()->run(jobs.size(), preprocess_variant, jobs.empty() ? NULL : &jobs[0]);
+
+	/* build in order, variants with identical sources share a program */
+	int ret = 0;
+	for ( size_t i = 0; i < todo.size() && ret == 0; i++ ){
+		std::vector<source_list*> src;
+		uint64_t h = hash_seed;
+
+		for ( size_t j = 0; j < _shader.size(); j++ ){
+			variant_job* cur = jobs[i * _shader.size() + j];
+
+			if ( log ){
+				log->append(cur->log);
+			}
+			if ( ret == 0 ){
+				ret = cur->ret;
+			}
+
+			h = glslfx::hash(&cur->target, sizeof(GLenum), h);
+			h = variant_hash(cur->src, _keywords, h);
+			src.push_back(&cur->src);
+		}
+
+		if ( ret != 0 ){
+			break;
+		}
+
+		std::map<uint64_t, GLuint>::const_iterator found = _variant_program.find(h);
+		if ( found != _variant_program.end() ){
+			insert_variant(todo[i], found->second);
+			continue;
+		}
+
+		/* a failed program is kept so it isn't rebuilt on every request */
+		std::vector<GLuint> shader;
+		GLuint sp;
+		GLint status;
+
+		ret = build(src, shader, sp, status, log);
+
+		if ( sp != 0 ){
+			_variant_program[h] = sp;
+			insert_variant(todo[i], sp);
+		}
+	}
+
+	for ( std::vector<variant_job*>::iterator it = jobs.begin(); it != jobs.end(); ++it ){
+		delete *it;
+	}
+
+	return ret;
 }
 
 bool pass::is_valid() const {
@@ -563,11 +1812,16 @@ bool pass::is_valid() const {
 }
 
 int pass::set_layout(struct layout_desc_t* layout, size_t stride, size_t n){
+	/* variants are linked with the attribute locations of the old layout */
+	clear_variants();
+
+	delete[] _layout.entry;
 	_layout.entry = new layout_entry[n];
 	_layout.stride = stride;
 	_layout.n = n;
 
 	for ( unsigned int i = 0; i < n; i++ ){
+		_layout.entry[i].name       = layout[i].name;
 		_layout.entry[i].attrib     = glGetAttribLocation(_sp, layout[i].name.c_str());
 		_layout.entry[i].components = layout[i].components;
 		_layout.entry[i].type       = layout[i].type;
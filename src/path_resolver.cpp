@@ -0,0 +1,208 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "path_resolver.h"
+#include "hash.h"
+#include "glslfx/file_provider.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+
+path_resolver::path_resolver()
+	: _base(".")
+	, _files(NULL)
+	, _hits(0)
+	, _misses(0) {
+
+	pthread_mutex_init(&_lock, NULL);
+}
+
+path_resolver::~path_resolver(){
+	pthread_mutex_destroy(&_lock);
+}
+
+void path_resolver::set_base(const std::string& dir){
+	_base = canonicalize(dir);
+	clear();
+}
+
+void path_resolver::add_search_path(const std::string& dir){
+	if ( !dir.empty() && dir[0] == '/' ){
+		_search.push_back(canonicalize(dir));
+	} else {
+		_search.push_back(canonicalize(_base + "/" + dir));
+	}
+	clear();
+}
+
+void path_resolver::clear_search_paths(){
+	_search.clear();
+	clear();
+}
+
+const std::vector<std::string>& path_resolver::search_paths() const {
+	return _search;
+}
+
+void path_resolver::set_provider(const file_provider* files){
+	_files = files;
+	clear();
+}
+
+/**
+ * Tell if a regular file exists.
+ */
+static bool exists(const file_provider* files, const std::string& path){
+	if ( files ){
+		include_cache::identity id;
+		return files->stat(path, id) == 0;
+	}
+
+	struct stat st;
+	return stat(path.c_str(), &st) == 0 && !S_ISDIR(st.st_mode);
+}
+
+std::string path_resolver::search(const std::string& in) const {
+	const std::string first = canonicalize(_base + "/" + in);
+
+	/* absolute paths are never searched for */
+	if ( !in.empty() && in[0] == '/' ){
+		return canonicalize(in);
+	}
+
+	if ( _search.empty() || exists(_files, first) ){
+		return first;
+	}
+
+	for ( std::vector<std::string>::const_iterator it = _search.begin(); it != _search.end(); ++it ){
+		std::string tmp = canonicalize(*it + "/" + in);
+		if ( exists(_files, tmp) ){
+			return tmp;
+		}
+	}
+
+	/* not found, the caller fails to open it and reports this path */
+	return first;
+}
+
+std::string path_resolver::resolve(const std::string& in){
+	const uint64_t key = glslfx::hash(in.data(), in.size());
+
+	pthread_mutex_lock(&_lock);
+	cache_map::const_iterator it = _cache.find(key);
+	if ( it != _cache.end() && it->second.ref == in ){
+		std::string path = it->second.path;
+		_hits++;
+		pthread_mutex_unlock(&_lock);
+		return path;
+	}
+	_misses++;
+	pthread_mutex_unlock(&_lock);
+
+	/* the filesystem is searched without holding the lock, two threads may
+	 * search for the same path but they reach the same result */
+	cached tmp;
+	tmp.ref = in;
+	tmp.path = search(in);
+
+	pthread_mutex_lock(&_lock);
+	if ( _cache.find(key) == _cache.end() ){
+		_cache.insert(std::make_pair(key, tmp));
+	}
+	pthread_mutex_unlock(&_lock);
+
+	return tmp.path;
+}
+
+void path_resolver::clear(){
+	pthread_mutex_lock(&_lock);
+	_cache.clear();
+	pthread_mutex_unlock(&_lock);
+}
+
+unsigned int path_resolver::hits() const {
+	pthread_mutex_lock(&_lock);
+	unsigned int n = _hits;
+	pthread_mutex_unlock(&_lock);
+	return n;
+}
+
+unsigned int path_resolver::misses() const {
+	pthread_mutex_lock(&_lock);
+	unsigned int n = _misses;
+	pthread_mutex_unlock(&_lock);
+	return n;
+}
+
+std::string path_resolver::canonicalize(const std::string& path){
+	const bool absolute = !path.empty() && path[0] == '/';
+	std::vector<std::string> parts;
+	size_t pos = 0;
+
+	while ( pos <= path.size() ){
+		size_t end = path.find('/', pos);
+		if ( end == std::string::npos ){
+			end = path.size();
+		}
+
+		const std::string cur = path.substr(pos, end - pos);
+		pos = end + 1;
+
+		if ( cur.empty() || cur == "." ){
+			continue;
+		}
+
+		if ( cur == ".." ){
+			/* ".." of the root is the root itself, relative paths keeps
+			 * leading ".." */
+			if ( !parts.empty() && parts.back() != ".." ){
+				parts.pop_back();
+			} else if ( !absolute ){
+				parts.push_back(cur);
+			}
+			continue;
+		}
+
+		parts.push_back(cur);
+	}
+
+	std::string dst = absolute ? "/" : "";
+	for ( std::vector<std::string>::const_iterator it = parts.begin(); it != parts.end(); ++it ){
+		if ( it != parts.begin() ){
+			dst += '/';
+		}
+		dst += *it;
+	}
+
+	if ( dst.empty() ){
+		dst = ".";
+	}
+
+	return dst;
+}
@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __GLSL_FX_PATH_RESOLVER_H
+#define __GLSL_FX_PATH_RESOLVER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace glslfx {
+
+	class file_provider;
+
+	/**
+	 * Resolves paths referenced by an effect into canonical paths. Relative
+	 * paths are searched for in the base directory followed by the search
+	 * paths, in order. Results are cached, including paths which could not
+	 * be found, so each reference only touches the filesystem once until the
+	 * cache is cleared. May be used from several threads at once.
+	 */
+	class path_resolver {
+	public:
+		path_resolver();
+		~path_resolver();
+
+		/**
+		 * Set the directory relative paths are resolved against first.
+		 * Relative search paths are also relative to this directory.
+		 */
+		void set_base(const std::string& dir);
+
+		/**
+		 * Append a directory to the search path.
+		 */
+		void add_search_path(const std::string& dir);
+
+		void clear_search_paths();
+
+		const std::vector<std::string>& search_paths() const;
+
+		/**
+		 * Look for files through a provider instead of the filesystem.
+		 * @param files Provider, NULL for the filesystem.
+		 */
+		void set_provider(const file_provider* files);
+
+		/**
+		 * Resolve a path. If the file cannot be found in any directory the
+		 * path relative to the base directory is returned so the caller
+		 * reports a sensible path when it fails to open it.
+		 */
+		std::string resolve(const std::string& in);
+
+		/**
+		 * Drop all cached lookups, eg. when files might have been created
+		 * or removed.
+		 */
+		void clear();
+
+		/**
+		 * Number of lookups served from the cache.
+		 */
+		unsigned int hits() const;
+
+		/**
+		 * Number of lookups which had to search the filesystem.
+		 */
+		unsigned int misses() const;
+
+		/**
+		 * Lexically canonicalize a path, removing empty and "." components
+		 * and folding ".." into the preceding component. Symbolic links are
+		 * not followed.
+		 */
+		static std::string canonicalize(const std::string& path);
+
+	private:
+		path_resolver(const path_resolver&);
+		path_resolver& operator=(const path_resolver&);
+
+		typedef struct {
+			std::string ref;   /* the path as referenced */
+			std::string path;  /* resolved path */
+		} cached;
+
+		/* keyed by the hash of the reference, colliding references are
+		 * resolved without being cached */
+		typedef std::map<uint64_t, cached> cache_map;
+
+		/**
+		 * Search the filesystem for a relative path.
+		 */
+		std::string search(const std::string& in) const;
+
+		std::string _base;
+		const file_provider* _files;
+		std::vector<std::string> _search;
+		cache_map _cache;
+		unsigned int _hits;
+		unsigned int _misses;
+		mutable pthread_mutex_t _lock;
+	};
+
+}
+
+#endif /* __GLSL_FX_PATH_RESOLVER_H */
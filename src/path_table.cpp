@@ -0,0 +1,200 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "path_table.h"
+#include "glslfx/glslfx.h"
+#include "hash.h"
+#include <cstring>
+
+/* entries and indices are published with release stores so a reader which
+ * sees a handle (or index) also sees everything written before it */
+template <class T>
+static inline T load_acquire(const T* ptr){
+#ifdef _MSC_VER
+	return *(const volatile T*)ptr;
+#else
+	return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+template <class T>
+static inline void store_release(T* ptr, T value){
+#ifdef _MSC_VER
+	*(volatile T*)ptr = value;
+#else
+	__atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+}
+
+static const size_t initial_slots = 256;
+
+path_table::path_table()
+	: _size(0) {
+
+	memset(_block, 0, sizeof(_block));
+
+	_index = new index;
+	_index->mask = initial_slots - 1;
+	_index->slot = new uint32_t[initial_slots];
+	memset(_index->slot, 0, sizeof(uint32_t) * initial_slots);
+
+	pthread_mutex_init(&_lock, NULL);
+}
+
+path_table::~path_table(){
+	for ( unsigned int i = 0; i < _size; i++ ){
+		delete _block[i >> BLOCK_BITS][i & (BLOCK_SIZE - 1)];
+	}
+
+	for ( unsigned int i = 0; i < MAX_BLOCKS; i++ ){
+		delete [] _block[i];
+	}
+
+	_retired.push_back(_index);
+	for ( std::vector<index*>::iterator it = _retired.begin(); it != _retired.end(); ++it ){
+		delete [] (*it)->slot;
+		delete *it;
+	}
+
+	pthread_mutex_destroy(&_lock);
+}
+
+uint32_t* path_table::probe(const index* idx, uint64_t hash, const std::string& path) const {
+	size_t i = (size_t)hash & idx->mask;
+
+	for ( ;; i = (i + 1) & idx->mask ){
+		uint32_t* slot = &idx->slot[i];
+		const uint32_t value = load_acquire(slot);
+
+		if ( value == 0 ){
+			return slot;
+		}
+
+		const unsigned int handle = value - 1;
+		const item* cur = _block[handle >> BLOCK_BITS][handle & (BLOCK_SIZE - 1)];
+		if ( cur->hash == hash && cur->path == path ){
+			return slot;
+		}
+	}
+}
+
+int path_table::find(const std::string& path, unsigned int& handle) const {
+	const uint64_t h = glslfx::hash(path.data(), path.size());
+	const uint32_t value = load_acquire(probe(load_acquire(&_index), h, path));
+
+	if ( value == 0 ){
+		return E_NOT_FOUND;
+	}
+
+	handle = value - 1;
+	return 0;
+}
+
+int path_table::store(const std::string& path, unsigned int& handle){
+	const uint64_t h = glslfx::hash(path.data(), path.size());
+
+	/* fast path, already interned */
+	uint32_t value = load_acquire(probe(load_acquire(&_index), h, path));
+	if ( value != 0 ){
+		handle = value - 1;
+		return 0;
+	}
+
+	pthread_mutex_lock(&_lock);
+
+	/* might have been stored while waiting for the lock */
+	uint32_t* slot = probe(_index, h, path);
+	if ( *slot != 0 ){
+		handle = *slot - 1;
+		pthread_mutex_unlock(&_lock);
+		return 0;
+	}
+
+	const unsigned int n = _size;
+
+	if ( (n >> BLOCK_BITS) >= MAX_BLOCKS ){
+		pthread_mutex_unlock(&_lock);
+		return E_OUT_OF_RANGE;
+	}
+
+	/* append to the dense table */
+	if ( !_block[n >> BLOCK_BITS] ){
+		item** tmp = new item*[BLOCK_SIZE];
+		store_release(&_block[n >> BLOCK_BITS], tmp);
+	}
+
+	item* cur = new item;
+	cur->hash = h;
+	cur->path = path;
+	_block[n >> BLOCK_BITS][n & (BLOCK_SIZE - 1)] = cur;
+	store_release(&_size, n + 1);
+
+	/* keep the load factor below 1/2 */
+	if ( (size_t)(n + 1) * 2 > _index->mask + 1 ){
+		grow();
+		slot = probe(_index, h, path);
+	}
+
+	store_release(slot, n + 1);
+	handle = n;
+
+	pthread_mutex_unlock(&_lock);
+	return 0;
+}
+
+void path_table::grow(){
+	const size_t slots = (_index->mask + 1) * 2;
+	index* tmp = new index;
+	tmp->mask = slots - 1;
+	tmp->slot = new uint32_t[slots];
+	memset(tmp->slot, 0, sizeof(uint32_t) * slots);
+
+	/* the newest item is left out, it is inserted by the caller */
+	for ( unsigned int i = 0; i + 1 < _size; i++ ){
+		const item* cur = _block[i >> BLOCK_BITS][i & (BLOCK_SIZE - 1)];
+		*probe(tmp, cur->hash, cur->path) = i + 1;
+	}
+
+	/* the old index cannot be freed as readers may still probe it */
+	_retired.push_back(_index);
+	store_release(&_index, tmp);
+}
+
+const std::string* path_table::retrieve(unsigned int handle) const {
+	if ( handle >= load_acquire(&_size) ){
+		return NULL;
+	}
+
+	return &_block[handle >> BLOCK_BITS][handle & (BLOCK_SIZE - 1)]->path;
+}
+
+unsigned int path_table::size() const {
+	return load_acquire(&_size);
+}
@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __GLSL_FX_PATH_TABLE_H
+#define __GLSL_FX_PATH_TABLE_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace glslfx {
+
+	/**
+	 * Interned paths, mapping each distinct path to a small integer handle.
+	 * Handles are assigned in order starting at 0 and never change. Paths
+	 * are kept in a dense table indexed by handle and found through an open
+	 * addressing hash index. Lookups of stored paths and handles are
+	 * lock-free, only inserting a new path takes the lock.
+	 */
+	class path_table {
+	public:
+		path_table();
+		~path_table();
+
+		/**
+		 * Get the handle of a path, storing it if it isn't interned yet.
+		 * @param path Path to store.
+		 * @param handle Output
+		 * @return 0 if successful or E_OUT_OF_RANGE if the table is full.
+		 */
+		int store(const std::string& path, unsigned int& handle);
+
+		/**
+		 * Get the handle of a path without storing it.
+		 * @return 0 if successful or E_NOT_FOUND.
+		 */
+		int find(const std::string& path, unsigned int& handle) const;
+
+		/**
+		 * Get the path of a handle. The string lives as long as the table.
+		 * @return The path or NULL if the handle isn't valid.
+		 */
+		const std::string* retrieve(unsigned int handle) const;
+
+		/**
+		 * Number of interned paths.
+		 */
+		unsigned int size() const;
+
+	private:
+		path_table(const path_table&);
+		path_table& operator=(const path_table&);
+
+		enum {
+			BLOCK_BITS = 10,
+			BLOCK_SIZE = 1 << BLOCK_BITS,
+			MAX_BLOCKS = 4096
+		};
+
+		typedef struct {
+			uint64_t hash;
+			std::string path;
+		} item;
+
+		typedef struct {
+			size_t mask;     /* number of slots - 1 */
+			uint32_t* slot;  /* handle + 1, 0 if empty */
+		} index;
+
+		/**
+		 * Search an index for a path, returns the slot where it is stored or
+		 * the empty slot where it would be stored.
+		 */
+		uint32_t* probe(const index* idx, uint64_t hash, const std::string& path) const;
+
+		/**
+		 * Replace the index with one twice as large.
+		 */
+		void grow();
+
+		item** _block[MAX_BLOCKS]; /* dense table, blocks are never moved */
+		unsigned int _size;
+		index* _index;
+		std::vector<index*> _retired; /* replaced indices, readers may still use them */
+		pthread_mutex_t _lock;     /* serializes inserts */
+	};
+
+}
+
+#endif /* __GLSL_FX_PATH_TABLE_H */
@@ -0,0 +1,592 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "prefetch.h"
+#include "glslfx/effect.h"
+#include "glslfx/glslfx.h"
+#include "glslfx/technique.h"
+#include "glslfx/pass.h"
+#include "glslfx/thread_pool.h"
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <set>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#	include <linux/io_uring.h>
+#	include <sys/mman.h>
+#	include <sys/syscall.h>
+#	if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#		define USE_IO_URING 1
+#	endif
+#endif /* HAVE_LINUX_IO_URING_H */
+
+/**
+ * Read the rest of a file from an offset.
+ */
+static int read_rest(int fd, char* buf, size_t size, size_t offset){
+	while ( offset < size ){
+		ssize_t n = pread(fd, buf + offset, size - offset, offset);
+		if ( n < 0 ){
+			if ( errno == EINTR ){
+				continue;
+			}
+			return errno;
+		}
+
+		/* truncated while reading */
+		if ( n == 0 ){
+			return EIO;
+		}
+
+		offset += n;
+	}
+
+	return 0;
+}
+
+/**
+ * Take the contents of an open file.
+ */
+static void finish(batch_reader::request& req, char* buf, size_t size, const struct stat& st){
+	req.file = new mapped_file;
+	req.file->adopt(buf, size, st);
+	req.error = 0;
+}
+
+/**
+ * Read a file synchronously.
+ */
+static void read_file(batch_reader::request& req){
+	struct stat st;
+	int fd;
+
+	req.file = NULL;
+
+	if ( ( fd = open(req.path.c_str(), O_RDONLY | O_CLOEXEC) ) == -1 ){
+		req.error = errno;
+		return;
+	}
+
+	/* special files have no meaningful size, they are read until they end */
+	if ( fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0 ){
+		close(fd);
+		req.file = new mapped_file;
+		if ( ( req.error = req.file->open(req.path) ) != 0 ){
+			delete req.file;
+			req.file = NULL;
+		}
+		return;
+	}
+
+	char* buf = (char*)malloc(st.st_size);
+	if ( !buf ){
+		close(fd);
+		req.error = ENOMEM;
+		return;
+	}
+
+	if ( ( req.error = read_rest(fd, buf, st.st_size, 0) ) != 0 ){
+		free(buf);
+	} else {
+		finish(req, buf, st.st_size, st);
+	}
+
+	close(fd);
+}
+
+#ifdef USE_IO_URING
+
+/* number of submission queue entries, larger batches are submitted as slots
+ * are freed */
+static const unsigned ring_entries = 64;
+
+struct batch_reader::ring {
+	int fd;
+	unsigned entries;
+
+	unsigned* sq_head;
+	unsigned* sq_tail;
+	unsigned* sq_mask;
+	unsigned* sq_array;
+	struct io_uring_sqe* sqes;
+
+	unsigned* cq_head;
+	unsigned* cq_tail;
+	unsigned* cq_mask;
+	struct io_uring_cqe* cqes;
+
+	void* sq_ptr;
+	size_t sq_size;
+	void* cq_ptr;
+	size_t cq_size;
+	size_t sqes_size;
+
+	int run(const std::vector<struct io_uring_sqe>& ops, std::vector<int>& res);
+};
+
+int batch_reader::uring_setup(){
+	struct io_uring_params p;
+	ring* r = new ring;
+
+	memset(&p, 0, sizeof(p));
+	memset(r, 0, sizeof(ring));
+
+	/* fails with ENOSYS on older kernels or EPERM if disabled */
+	if ( ( r->fd = syscall(__NR_io_uring_setup, ring_entries, &p) ) < 0 ){
+		int ret = errno;
+		delete r;
+		return ret;
+	}
+
+	r->entries = p.sq_entries;
+	r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	/* both rings may share a single mapping */
+	const bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+	if ( single ){
+		r->sq_size = r->cq_size = std::max(r->sq_size, r->cq_size);
+	}
+
+	_ring = r;
+
+	r->sq_ptr = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	if ( r->sq_ptr == MAP_FAILED ){
+		r->sq_ptr = NULL;
+		uring_close();
+		return errno;
+	}
+
+	if ( single ){
+		r->cq_ptr = r->sq_ptr;
+	} else {
+		r->cq_ptr = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+		if ( r->cq_ptr == MAP_FAILED ){
+			r->cq_ptr = NULL;
+			uring_close();
+			return errno;
+		}
+	}
+
+	void* sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if ( sqes == MAP_FAILED ){
+		uring_close();
+		return errno;
+	}
+
+	char* sq = (char*)r->sq_ptr;
+	char* cq = (char*)r->cq_ptr;
+	r->sq_head = (unsigned*)(sq + p.sq_off.head);
+	r->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+	r->sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+	r->sq_array = (unsigned*)(sq + p.sq_off.array);
+	r->sqes = (struct io_uring_sqe*)sqes;
+	r->cq_head = (unsigned*)(cq + p.cq_off.head);
+	r->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+	r->cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+	return 0;
+}
+
+void batch_reader::uring_close(){
+	if ( !_ring ){
+		return;
+	}
+
+	if ( _ring->sqes ){
+		munmap(_ring->sqes, _ring->sqes_size);
+	}
+	if ( _ring->cq_ptr && _ring->cq_ptr != _ring->sq_ptr ){
+		munmap(_ring->cq_ptr, _ring->cq_size);
+	}
+	if ( _ring->sq_ptr ){
+		munmap(_ring->sq_ptr, _ring->sq_size);
+	}
+
+	close(_ring->fd);
+	delete _ring;
+	_ring = NULL;
+}
+
+/**
+ * Run a batch of operations through the ring, the user data of each
+ * operation is its index and its result is written to res[index]. Returns
+ * errno if the ring fails, in which case no more operations are submitted
+ * but those already submitted are waited for. Operations which were never
+ * submitted are left as -ECANCELED. If the ring fails while waiting, the
+ * operations still in flight are left as -EINPROGRESS and the kernel may
+ * still use their buffers.
+ */
+int batch_reader::ring::run(const std::vector<struct io_uring_sqe>& ops, std::vector<int>& res){
+	size_t next = 0;
+	size_t inflight = 0;
+	int ret = 0;
+
+	res.assign(ops.size(), -ECANCELED);
+
+	while ( ( ret == 0 && next < ops.size() ) || inflight > 0 ){
+		unsigned tail = *sq_tail;
+		unsigned submit = 0;
+
+		/* fill free slots */
+		while ( ret == 0 && next < ops.size() && inflight + submit < entries ){
+			const unsigned index = tail & *sq_mask;
+			sqes[index] = ops[next];
+			sqes[index].user_data = next;
+			sq_array[index] = index;
+			res[next] = -EINPROGRESS;
+			tail++;
+			next++;
+			submit++;
+		}
+		__atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+		inflight += submit;
+
+		/* submit everything still queued and wait for at least one
+		 * completion, an interrupted call may have submitted some */
+		for (;;){
+			const unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+			if ( syscall(__NR_io_uring_enter, fd, tail - head, 1, IORING_ENTER_GETEVENTS, NULL, 0) >= 0 ){
+				break;
+			}
+			if ( errno == EINTR ){
+				continue;
+			}
+
+			/* completion queue is full, reap before waiting again */
+			if ( errno == EAGAIN || errno == EBUSY ){
+				break;
+			}
+
+			/* the ring itself is broken, nothing more can be reaped */
+			if ( ret != 0 ){
+				return ret;
+			}
+
+			/* stop submitting, entries the kernel hasn't consumed never
+			 * started and are taken back. Those already submitted still
+			 * write to their buffers so they must complete first. */
+			ret = errno;
+			for ( unsigned i = head; i != tail; i++ ){
+				res[--next] = -ECANCELED;
+				inflight--;
+			}
+			tail = head;
+			__atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+			if ( inflight == 0 ){
+				return ret;
+			}
+		}
+
+		/* reap */
+		unsigned head = *cq_head;
+		const unsigned end = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+		while ( head != end ){
+			const struct io_uring_cqe& cqe = cqes[head & *cq_mask];
+			res[cqe.user_data] = cqe.res;
+			inflight--;
+			head++;
+		}
+		__atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	return ret;
+}
+
+void batch_reader::uring_read(std::vector<request>& requests){
+	const size_t n = requests.size();
+	std::vector<struct io_uring_sqe> ops;
+	std::vector<int> res;
+	std::vector<int> fds(n, -1);
+	std::vector<struct stat> st(n);
+	std::vector<char*> buf(n, (char*)NULL);
+	std::vector<size_t> pending; /* requests with a read in flight */
+
+	/* open all files at once */
+	ops.resize(n);
+	for ( size_t i = 0; i < n; i++ ){
+		memset(&ops[i], 0, sizeof(struct io_uring_sqe));
+		ops[i].opcode = IORING_OP_OPENAT;
+		ops[i].fd = AT_FDCWD;
+		ops[i].addr = (uintptr_t)requests[i].path.c_str();
+		ops[i].open_flags = O_RDONLY | O_CLOEXEC;
+	}
+
+	/* operations which never completed are read the normal way, the ring
+	 * isn't used again. An open which is still in flight leaks its
+	 * descriptor. */
+	if ( _ring->run(ops, res) != 0 ){
+		uring_close();
+	}
+
+	ops.clear();
+	for ( size_t i = 0; i < n; i++ ){
+		request& req = requests[i];
+		req.file = NULL;
+
+		/* the kernel may lack the operation, read it the normal way */
+		if ( res[i] == -EINVAL || res[i] == -EOPNOTSUPP || res[i] == -ECANCELED || res[i] == -EINPROGRESS ){
+			read_file(req);
+			continue;
+		}
+
+		if ( res[i] < 0 ){
+			req.error = -res[i];
+			continue;
+		}
+
+		/* attributes are already known after the open */
+		fds[i] = res[i];
+		if ( fstat(fds[i], &st[i]) != 0 || !S_ISREG(st[i].st_mode) || st[i].st_size == 0 ||
+			 ( buf[i] = (char*)malloc(st[i].st_size) ) == NULL ){
+			close(fds[i]);
+			fds[i] = -1;
+			read_file(req);
+			continue;
+		}
+
+		struct io_uring_sqe op;
+		memset(&op, 0, sizeof(op));
+		op.opcode = IORING_OP_READ;
+		op.fd = fds[i];
+		op.addr = (uintptr_t)buf[i];
+		op.len = st[i].st_size > 0x7ffff000 ? 0x7ffff000 : st[i].st_size;
+		op.off = 0;
+		ops.push_back(op);
+		pending.push_back(i);
+	}
+
+	/* read all files at once */
+	if ( !_ring ){
+		res.assign(ops.size(), -ECANCELED);
+	} else if ( !ops.empty() && _ring->run(ops, res) != 0 ){
+		uring_close();
+	}
+
+	for ( size_t j = 0; j < pending.size(); j++ ){
+		const size_t i = pending[j];
+		request& req = requests[i];
+		size_t done = res[j] > 0 ? res[j] : 0;
+
+		/* the kernel may still write to the buffer, it is leaked rather
+		 * than reused */
+		if ( res[j] == -EINPROGRESS ){
+			close(fds[i]);
+			read_file(req);
+			continue;
+		}
+
+		if ( res[j] < 0 && res[j] != -EINVAL && res[j] != -EOPNOTSUPP && res[j] != -ECANCELED ){
+			req.error = -res[j];
+		} else {
+			/* short reads and unsupported operations are completed normally */
+			req.error = read_rest(fds[i], buf[i], st[i].st_size, done);
+		}
+
+		if ( req.error == 0 ){
+			finish(req, buf[i], st[i].st_size, st[i]);
+		} else {
+			free(buf[i]);
+		}
+
+		close(fds[i]);
+	}
+}
+
+#else /* USE_IO_URING */
+
+struct batch_reader::ring {
+
+};
+
+int batch_reader::uring_setup(){
+	return ENOSYS;
+}
+
+void batch_reader::uring_close(){
+
+}
+
+void batch_reader::uring_read(std::vector<request>&){
+
+}
+
+#endif /* USE_IO_URING */
+
+batch_reader::batch_reader(thread_pool* pool, bool uring)
+	: _pool(pool)
+	, _ring(NULL) {
+
+	if ( uring ){
+		uring_setup();
+	}
+}
+
+batch_reader::~batch_reader(){
+	uring_close();
+}
+
+bool batch_reader::uring() const {
+	return _ring != NULL;
+}
+
+void batch_reader::read_job(void* data, size_t index){
+	read_file(((request*)data)[index]);
+}
+
+void batch_reader::read(std::vector<request>& requests){
+	if ( requests.empty() ){
+		return;
+	}
+
+	if ( _ring ){
+		uring_read(requests);
+	} else {
+		_pool->run(requests.size(), read_job, &requests[0]);
+	}
+}
+
+typedef struct {
+	include_cache* cache;
+	batch_reader::request* requests;
+	const include_cache::entry** entries;
+} scan_batch;
+
+/**
+ * Scan a file which has been read, run by the thread pool.
+ */
+static void scan_job(void* data, size_t index){
+	scan_batch* batch = (scan_batch*)data;
+	batch_reader::request& req = batch->requests[index];
+
+	batch->entries[index] = NULL;
+	if ( !req.file ){
+		return;
+	}
+
+	/* errors are reported when the file is used */
+	if ( include_store(batch->cache, req.path, req.file, &batch->entries[index], NULL) != 0 ){
+		batch->entries[index] = NULL;
+	}
+	req.file = NULL;
+}
+
+int effect::prefetch(){
+	include_cache::scope scope(_includes);
+	std::set<std::string> seen;
+	std::vector<std::string> level;
+	batch_reader reader(pool());
+
+	/* root sources of all shaders which aren't baked */
+	for ( iterator it = technique_begin(); it != technique_end(); ++it ){
+		technique* tech = it->second;
+		for ( technique::iterator p = tech->pass_begin(); p != tech->pass_end(); ++p ){
+			for ( pass::iterator s = (*p)->_shader.begin(); s != (*p)->_shader.end(); ++s ){
+				const std::string path = resolve_path(s->second.path);
+				if ( !s->second.baked && seen.insert(path).second ){
+					level.push_back(path);
+				}
+			}
+		}
+	}
+
+	/* each level of the include tree is read as a single batch */
+	while ( !level.empty() ){
+		std::vector<batch_reader::request> todo;
+		std::vector<const include_cache::entry*> found;
+
+		for ( std::vector<std::string>::const_iterator it = level.begin(); it != level.end(); ++it ){
+			const include_cache::entry* cached = _includes->find(*it, _files);
+			if ( cached ){
+				found.push_back(cached);
+			} else {
+				batch_reader::request tmp;
+				tmp.path = *it;
+				tmp.file = NULL;
+				tmp.error = 0;
+				todo.push_back(tmp);
+			}
+		}
+
+		/* providers already have the contents in memory */
+		if ( _files ){
+			for ( std::vector<batch_reader::request>::iterator it = todo.begin(); it != todo.end(); ++it ){
+				it->file = new mapped_file;
+				if ( ( it->error = it->file->open(_files, it->path) ) != 0 ){
+					delete it->file;
+					it->file = NULL;
+				}
+			}
+		} else {
+			reader.read(todo);
+		}
+
+		if ( !todo.empty() ){
+			std::vector<const include_cache::entry*> entries(todo.size());
+			scan_batch batch = {_includes, &todo[0], &entries[0]};
+			pool()->run(todo.size(), scan_job, &batch);
+
+			for ( std::vector<const include_cache::entry*>::const_iterator it = entries.begin(); it != entries.end(); ++it ){
+				if ( *it ){
+					found.push_back(*it);
+				}
+			}
+		}
+
+		/* includes in disabled branches are read as well, they are cheap to
+		 * cache compared to another round trip */
+		level.clear();
+		for ( std::vector<const include_cache::entry*>::const_iterator it = found.begin(); it != found.end(); ++it ){
+			const include_cache::entry* entry = *it;
+			for ( std::vector<include_cache::piece>::const_iterator p = entry->pieces.begin(); p != entry->pieces.end(); ++p ){
+				if ( p->type != include_cache::piece::INCLUDE ){
+					continue;
+				}
+
+				const std::string path = resolve_path(std::string(entry->file->data() + p->offset, p->size));
+				if ( seen.insert(path).second ){
+					level.push_back(path);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __GLSL_FX_PREFETCH_H
+#define __GLSL_FX_PREFETCH_H
+
+#include "glslfx/include_cache.h"
+#include "mapped_file.h"
+#include <string>
+#include <vector>
+
+namespace glslfx {
+
+	class log_sink;
+	class thread_pool;
+
+	/**
+	 * Scan a file which has already been read and store it in an include
+	 * cache (implemented along with the preprocessor in pass.cpp). The
+	 * cache takes ownership of the file, it is deleted if scanning fails.
+	 * @param dst Output, the stored entry.
+	 */
+	int include_store(include_cache* cache,
+					  const std::string& filename,
+					  mapped_file* file,
+					  const include_cache::entry** dst,
+					  log_sink* log);
+
+	/**
+	 * Reads many files at once. On Linux all opens and all reads are each
+	 * submitted as a single batch through io_uring so the latency of each
+	 * file overlaps, otherwise (or if io_uring is unavailable) the files
+	 * are read by the threads of a pool. Files are read into memory rather
+	 * than mapped so no I/O is left for page faults later on.
+	 */
+	class batch_reader {
+	public:
+		typedef struct {
+			std::string path;
+			mapped_file* file; /* output, NULL if the file could not be read */
+			int error;         /* output, errno if the file could not be read */
+		} request;
+
+		/**
+		 * @param pool Pool used if io_uring is unavailable.
+		 * @param uring Use io_uring if available, false always reads
+		 *              through the pool.
+		 */
+		batch_reader(thread_pool* pool, bool uring = true);
+		~batch_reader();
+
+		/**
+		 * Read all files and wait for them to finish.
+		 */
+		void read(std::vector<request>& requests);
+
+		/**
+		 * Tell if io_uring is used.
+		 */
+		bool uring() const;
+
+	private:
+		batch_reader(const batch_reader&);
+		batch_reader& operator=(const batch_reader&);
+
+		struct ring;
+
+		static void read_job(void* data, size_t index);
+
+		int uring_setup();
+		void uring_close();
+		void uring_read(std::vector<request>& requests);
+
+		thread_pool* _pool;
+		ring* _ring; /* NULL if io_uring is unavailable */
+	};
+
+}
+
+#endif /* __GLSL_FX_PREFETCH_H */
@@ -0,0 +1,277 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "glslfx/reloader.h"
+#include "glslfx/glslfx.h"
+#include "path_resolver.h"
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_INOTIFY_H
+#	include <sys/inotify.h>
+#endif /* HAVE_SYS_INOTIFY_H */
+
+/**
+ * Directory part of a path, including the trailing slash.
+ */
+static std::string directory(const std::string& path){
+	size_t s = path.find_last_of('/');
+	return s == std::string::npos ? "" : path.substr(0, s + 1);
+}
+
+reloader::reloader(effect* ep)
+	: ep(ep)
+	, _fd(-1)
+	, _effect_changed(false)
+	, _rebuilt(0) {
+
+#ifdef HAVE_SYS_INOTIFY_H
+	/* if inotify is unavailable (eg. out of instances) files are polled instead */
+	_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif /* HAVE_SYS_INOTIFY_H */
+}
+
+reloader::~reloader(){
+	if ( _fd != -1 ){
+		close(_fd);
+	}
+}
+
+int reloader::watch(){
+	int ret;
+
+	if ( ( ret = add(ep->filename()) ) != 0 ){
+		return ret;
+	}
+
+	for ( effect::dependant_map::const_iterator it = ep->_dependants.begin(); it != ep->_dependants.end(); ++it ){
+		if ( ( ret = add(it->first) ) != 0 ){
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+int reloader::add(const std::string& path){
+	if ( _files.find(path) != _files.end() ){
+		return 0;
+	}
+
+	/* a missing file is still watched, it might be created later */
+	include_cache::identity id;
+	memset(&id, 0, sizeof(include_cache::identity));
+	include_cache::stat(path, id);
+	_files[path] = id;
+
+#ifdef HAVE_SYS_INOTIFY_H
+	if ( _fd == -1 ){
+		return 0;
+	}
+
+	/* the directory is watched rather than the file itself as editors
+	 * usually replace the file when saving */
+	const std::string dir = directory(path);
+	if ( _dirs.find(dir) != _dirs.end() ){
+		return 0;
+	}
+
+	/* different spellings of a directory (eg. "a/" and "./a/") gets the same
+	 * watch descriptor, events are matched against all of them */
+	const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_ATTRIB;
+	int wd = inotify_add_watch(_fd, path_resolver::canonicalize(dir.empty() ? "." : dir).c_str(), mask);
+	if ( wd == -1 ){
+		/* files in a missing directory (eg. of an include which hasn't been
+		 * created yet) are polled instead */
+		if ( errno == ENOENT ){
+			_dirs[dir] = -1;
+			return 0;
+		}
+		return errno;
+	}
+
+	_dirs[dir] = wd;
+	_watches[wd].insert(dir);
+#endif /* HAVE_SYS_INOTIFY_H */
+
+	return 0;
+}
+
+int reloader::changes(std::vector<std::string>& dst){
+	bool poll = _fd == -1;
+
+#ifdef HAVE_SYS_INOTIFY_H
+	if ( _fd != -1 ){
+		char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+		for (;;){
+			ssize_t bytes = read(_fd, buf, sizeof(buf));
+
+			if ( bytes == -1 ){
+				if ( errno == EINTR ){
+					continue;
+				}
+				if ( errno == EAGAIN ){
+					break;
+				}
+				return errno;
+			}
+
+			for ( char* p = buf; p < buf + bytes; ){
+				const struct inotify_event* event = (const struct inotify_event*)p;
+				p += sizeof(struct inotify_event) + event->len;
+
+				/* events were lost, fall back to checking all files */
+				if ( event->mask & IN_Q_OVERFLOW ){
+					poll = true;
+					continue;
+				}
+
+				watch_map::const_iterator dirs = _watches.find(event->wd);
+				if ( dirs == _watches.end() || event->len == 0 ){
+					continue;
+				}
+
+				for ( std::set<std::string>::const_iterator dir = dirs->second.begin(); dir != dirs->second.end(); ++dir ){
+					std::string path = *dir + event->name;
+					file_map::iterator it = _files.find(path);
+					if ( it == _files.end() ){
+						continue;
+					}
+
+					include_cache::stat(path, it->second);
+					if ( std::find(dst.begin(), dst.end(), path) == dst.end() ){
+						dst.push_back(path);
+					}
+				}
+			}
+		}
+	}
+#endif /* HAVE_SYS_INOTIFY_H */
+
+	for ( file_map::iterator it = _files.begin(); it != _files.end(); ++it ){
+		/* only files which cannot be watched */
+		if ( !poll ){
+			dir_map::const_iterator dir = _dirs.find(directory(it->first));
+			if ( dir == _dirs.end() || dir->second != -1 ){
+				continue;
+			}
+		}
+
+		include_cache::identity cur;
+		memset(&cur, 0, sizeof(include_cache::identity));
+		include_cache::stat(it->first, cur);
+
+		if ( include_cache::same(cur, it->second) ){
+			continue;
+		}
+
+		it->second = cur;
+		if ( std::find(dst.begin(), dst.end(), it->first) == dst.end() ){
+			dst.push_back(it->first);
+		}
+	}
+
+	return 0;
+}
+
+int reloader::fd() const {
+	return _fd;
+}
+
+int reloader::update(log_sink* log){
+	std::vector<std::string> paths;
+	std::vector<pass*> passes;
+	int ret;
+
+	_rebuilt = 0;
+	_effect_changed = false;
+
+	if ( ( ret = changes(paths) ) != 0 ){
+		return ret;
+	}
+
+	/* find all affected passes, each is only rebuilt once even if several
+	 * of its files changed */
+	for ( std::vector<std::string>::const_iterator it = paths.begin(); it != paths.end(); ++it ){
+		std::vector<pass*> tmp;
+
+		if ( *it == ep->filename() ){
+			_effect_changed = true;
+		}
+
+		if ( ep->dependants(*it, tmp) != 0 ){
+			continue;
+		}
+
+		for ( std::vector<pass*>::const_iterator p = tmp.begin(); p != tmp.end(); ++p ){
+			if ( std::find(passes.begin(), passes.end(), *p) == passes.end() ){
+				passes.push_back(*p);
+			}
+		}
+	}
+
+	if ( passes.empty() ){
+		return 0;
+	}
+
+	/* files may have been created or removed since paths were resolved */
+	ep->_resolver->clear();
+
+	/* baked sources were expanded from the old files */
+	ep->discard_baked();
+
+	/* recompile, each pass keeps its program if the new one fails */
+	ret = 0;
+	for ( std::vector<pass*>::const_iterator it = passes.begin(); it != passes.end(); ++it ){
+		int tmp = (*it)->compile(log);
+		if ( tmp != 0 && ret == 0 ){
+			ret = tmp;
+		}
+		_rebuilt++;
+	}
+
+	/* includes may have been added or removed */
+	ep->index_dependants();
+	watch();
+
+	return ret;
+}
+
+bool reloader::effect_changed() const {
+	return _effect_changed;
+}
+
+unsigned int reloader::rebuilt() const {
+	return _rebuilt;
+}
@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "glslfx/shader_cache.h"
+
+shader_cache::shader_cache(){
+
+}
+
+shader_cache::~shader_cache(){
+
+}
+
+GLuint shader_cache::shader(GLenum target, uint64_t hash) const {
+	std::map<shader_key, shader_entry>::const_iterator it = _shaders.find(shader_key(target, hash));
+
+	if ( it == _shaders.end() ){
+		return 0;
+	}
+
+	return it->second.shader;
+}
+
+void shader_cache::add_shader(GLenum target, uint64_t hash, GLuint shader){
+	shader_entry tmp;
+	tmp.shader = shader;
+	tmp.refs = 0;
+
+	_shaders[shader_key(target, hash)] = tmp;
+	_shader_names[shader] = shader_key(target, hash);
+}
+
+GLuint shader_cache::program(uint64_t key){
+	std::map<uint64_t, GLuint>::const_iterator it = _program_keys.find(key);
+
+	if ( it == _program_keys.end() ){
+		return 0;
+	}
+
+	_programs[it->second].refs++;
+	return it->second;
+}
+
+void shader_cache::add_program(uint64_t key, GLuint program, const std::vector<GLuint>& shaders){
+	program_entry tmp;
+	tmp.key = key;
+	tmp.refs = 1;
+
+	for ( std::vector<GLuint>::const_iterator it = shaders.begin(); it != shaders.end(); ++it ){
+		std::map<GLuint, shader_key>::const_iterator name = _shader_names.find(*it);
+		if ( name == _shader_names.end() ){
+			continue;
+		}
+
+		_shaders[name->second].refs++;
+		tmp.shaders.push_back(name->second);
+	}
+
+	_program_keys[key] = program;
+	_programs[program] = tmp;
+}
+
+void shader_cache::release(GLuint program){
+	std::map<GLuint, program_entry>::iterator it = _programs.find(program);
+
+	if ( it == _programs.end() || --it->second.refs > 0 ){
+		return;
+	}
+
+	glDeleteProgram(program);
+
+	/* delete shaders no longer used by any program */
+	for ( std::vector<shader_key>::const_iterator key = it->second.shaders.begin(); key != it->second.shaders.end(); ++key ){
+		std::map<shader_key, shader_entry>::iterator cur = _shaders.find(*key);
+
+		if ( cur == _shaders.end() || --cur->second.refs > 0 ){
+			continue;
+		}
+
+		glDeleteShader(cur->second.shader);
+		_shader_names.erase(cur->second.shader);
+		_shaders.erase(cur);
+	}
+
+	_program_keys.erase(it->second.key);
+	_programs.erase(it);
+}
+
+void shader_cache::clear(){
+	for ( std::map<GLuint, program_entry>::iterator it = _programs.begin(); it != _programs.end(); ++it ){
+		glDeleteProgram(it->first);
+	}
+
+	for ( std::map<shader_key, shader_entry>::iterator it = _shaders.begin(); it != _shaders.end(); ++it ){
+		glDeleteShader(it->second.shader);
+	}
+
+	_shaders.clear();
+	_shader_names.clear();
+	_program_keys.clear();
+	_programs.clear();
+}
+
+size_t shader_cache::shaders() const {
+	return _shaders.size();
+}
+
+size_t shader_cache::programs() const {
+	return _programs.size();
+}
@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "source_list.h"
+#include "hash.h"
+#include <algorithm>
+
+source_list::source_list()
+	: _size(0) {
+
+}
+
+source_list::~source_list(){
+
+}
+
+void source_list::append(const char* ptr, size_t size){
+	if ( size == 0 ){
+		return;
+	}
+
+	_size += size;
+
+	/* extend previous segment if contiguous */
+	if ( !_strings.empty() ){
+		const GLchar* last = _strings.back();
+		if ( last + _lengths.back() == ptr ){
+			_lengths.back() += size;
+			return;
+		}
+	}
+
+	_strings.push_back(ptr);
+	_lengths.push_back(size);
+}
+
+void source_list::append_text(const std::string& text){
+	append(keep(text), text.size());
+}
+
+const char* source_list::keep(const std::string& text){
+	_text.push_back(text);
+	return _text.back().data();
+}
+
+void source_list::clear(){
+	_strings.clear();
+	_lengths.clear();
+	_text.clear();
+	_size = 0;
+	_lines.clear();
+}
+
+void source_list::swap(source_list& other){
+	/* list nodes keeps their address so kept text stays valid */
+	_strings.swap(other._strings);
+	_lengths.swap(other._lengths);
+	_text.swap(other._text);
+	std::swap(_size, other._size);
+	std::swap(_lines, other._lines);
+}
+
+line_map& source_list::lines(){
+	return _lines;
+}
+
+const line_map& source_list::lines() const {
+	return _lines;
+}
+
+GLsizei source_list::count() const {
+	return _strings.size();
+}
+
+size_t source_list::size() const {
+	return _size;
+}
+
+bool source_list::ends_with_newline() const {
+	if ( _strings.empty() ){
+		return true;
+	}
+
+	return _strings.back()[_lengths.back() - 1] == '\n';
+}
+
+unsigned int source_list::first_line(GLsizei string) const {
+	const GLsizei n = std::min(string, count());
+	unsigned int line = 1;
+
+	for ( GLsizei i = 0; i < n; i++ ){
+		line += std::count(_strings[i], _strings[i] + _lengths[i], '\n');
+	}
+
+	return line;
+}
+
+const GLchar** source_list::strings(){
+	return _strings.empty() ? NULL : &_strings[0];
+}
+
+const GLint* source_list::lengths() const {
+	return _lengths.empty() ? NULL : &_lengths[0];
+}
+
+void source_list::str(std::string& dst) const {
+	dst.clear();
+	dst.reserve(_size);
+
+	for ( size_t i = 0; i < _strings.size(); i++ ){
+		dst.append(_strings[i], _lengths[i]);
+	}
+}
+
+uint64_t source_list::hash(uint64_t seed) const {
+	uint64_t h = seed;
+
+	for ( size_t i = 0; i < _strings.size(); i++ ){
+		h = glslfx::hash(_strings[i], _lengths[i], h);
+	}
+
+	return h;
+}
@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __GLSL_FX_SOURCE_LIST_H
+#define __GLSL_FX_SOURCE_LIST_H
+
+#include <GL/glew.h>
+#include "line_map.h"
+#include <stdint.h>
+#include <list>
+#include <string>
+#include <vector>
+
+namespace glslfx {
+
+	/**
+	 * Preprocessed shader source as a list of segments, suitable to pass
+	 * directly to glShaderSource. The segments point into the include cache
+	 * (mapped files) so the cache must outlive the list. The origin of each
+	 * line is kept in the line map rather than as #line directives in the
+	 * source itself.
+	 */
+	class source_list {
+	public:
+		source_list();
+		~source_list();
+
+		/**
+		 * Append a segment. Adjacent segments are merged.
+		 */
+		void append(const char* ptr, size_t size);
+
+		/**
+		 * Append generated text. The list keeps its own copy.
+		 */
+		void append_text(const std::string& text);
+
+		/**
+		 * Keep a copy of generated text for as long as the list lives,
+		 * without appending it.
+		 * @return Pointer to the copy.
+		 */
+		const char* keep(const std::string& text);
+
+		void clear();
+
+		/**
+		 * Exchange contents with another list.
+		 */
+		void swap(source_list& other);
+
+		/**
+		 * Line map of the source, mapping each line to the file and line it
+		 * came from.
+		 */
+		line_map& lines();
+		const line_map& lines() const;
+
+		/**
+		 * Number of segments.
+		 */
+		GLsizei count() const;
+
+		/**
+		 * Total size in bytes.
+		 */
+		size_t size() const;
+
+		/**
+		 * Tell if the source ends with a newline (or is empty).
+		 */
+		bool ends_with_newline() const;
+
+		/**
+		 * Line in the concatenated source where a segment starts. Drivers
+		 * count lines per string so this is used to translate a (string,
+		 * line) pair in the info log into a line of the line map.
+		 * @param string Segment index.
+		 * @return Line (1-based).
+		 */
+		unsigned int first_line(GLsizei string) const;
+
+		const GLchar** strings();
+		const GLint* lengths() const;
+
+		/**
+		 * Concatenate all segments.
+		 */
+		void str(std::string& dst) const;
+
+		/**
+		 * Hash of the concatenated segments, independent of how the source
+		 * is split into segments.
+		 * @param seed Result of a previous hash to combine with.
+		 */
+		uint64_t hash(uint64_t seed) const;
+
+	private:
+		std::vector<const GLchar*> _strings;
+		std::vector<GLint> _lengths;
+		std::list<std::string> _text; /* generated text */
+		size_t _size;
+		line_map _lines;
+	};
+
+}
+
+#endif /* __GLSL_FX_SOURCE_LIST_H */
@@ -32,10 +32,13 @@
 #include "glslfx/technique.h"
 #include "glslfx/effect.h"
 #include "glslfx/pass.h"
+#include "glslfx/glslfx.h"
+#include "name_index.h"
 
 technique::technique(const effect* ep, const std::string& name)
 	: ep(ep)
-	, _name(name) {
+	, _name(name)
+	, _pass_index(new name_index) {
 
 }
 
@@ -43,13 +46,15 @@ technique::~technique(){
 	for ( iterator it = _pass.begin(); it != _pass.end(); ++it ){
 		delete (*it);
 	}
+
+	delete _pass_index;
 }
 
 const std::string& technique::name() const {
 	return _name;
 }
 
-int technique::compile(log* log){
+int technique::compile(log_sink* log){
 	int ret;
 
 	for ( iterator it = pass_begin(); it != pass_end(); ++it ){
@@ -80,10 +85,40 @@ technique::iterator technique::pass_end() {
 
 pass* technique::pass_new(const std::string& name){
 	pass* tmp = new pass(ep, name);
+
+	/* the handle is the position, a later pass with the same name keeps its
+	 * position but cannot be found by name */
+	_pass_index->insert(name, (pass_id)_pass.size());
 	_pass.push_back(tmp);
 	return tmp;
 }
 
+pass* technique::pass_get(const std::string& name) const {
+	pass_id id;
+
+	if ( _pass_index->find(name, id) != 0 ){
+		return NULL;
+	}
+
+	return _pass[id];
+}
+
+int technique::pass_find(const string_view& name, pass_id& dst) const {
+	return _pass_index->find(name, dst);
+}
+
+pass* technique::pass_at(pass_id id) const {
+	if ( id >= _pass.size() ){
+		return NULL;
+	}
+
+	return _pass[id];
+}
+
+size_t technique::pass_count() const {
+	return _pass.size();
+}
+
 bool technique::is_valid() const {
 	for ( const_iterator it = pass_begin(); it != pass_end(); ++it ){
 		pass* p = *it;
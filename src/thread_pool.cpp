@@ -0,0 +1,176 @@
+/**
+ * Copyright (c) 2010, David Sveningsson <ext-glslfx@sidvind.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the author nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#	include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "glslfx/thread_pool.h"
+#include <unistd.h>
+
+thread_pool::thread_pool(unsigned int threads)
+	: _threads(threads > 0 ? threads : processors())
+	, _func(NULL)
+	, _data(NULL)
+	, _n(0)
+	, _next(0)
+	, _finished(0)
+	, _batch(0)
+	, _quit(false) {
+
+	pthread_mutex_init(&_lock, NULL);
+	pthread_cond_init(&_wake, NULL);
+	pthread_cond_init(&_done, NULL);
+	pthread_cond_init(&_idle, NULL);
+}
+
+thread_pool::~thread_pool(){
+	pthread_mutex_lock(&_lock);
+	_quit = true;
+	pthread_cond_broadcast(&_wake);
+	pthread_mutex_unlock(&_lock);
+
+	for ( std::vector<pthread_t>::iterator it = _workers.begin(); it != _workers.end(); ++it ){
+		pthread_join(*it, NULL);
+	}
+
+	pthread_cond_destroy(&_idle);
+	pthread_cond_destroy(&_done);
+	pthread_cond_destroy(&_wake);
+	pthread_mutex_destroy(&_lock);
+}
+
+unsigned int thread_pool::processors(){
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (unsigned int)n : 1;
+}
+
+unsigned int thread_pool::threads() const {
+	return _threads;
+}
+
+int thread_pool::start(){
+	/* the caller is one of the threads */
+	while ( _workers.size() + 1 < _threads ){
+		pthread_t tmp;
+		int ret;
+
+		if ( ( ret = pthread_create(&tmp, NULL, worker, this) ) != 0 ){
+			/* run with the threads started so far */
+			_threads = _workers.size() + 1;
+			return ret;
+		}
+
+		_workers.push_back(tmp);
+	}
+
+	return 0;
+}
+
+int thread_pool::run(size_t n, func_t func, void* data){
+	if ( n == 0 ){
+		return 0;
+	}
+
+	/* not worth waking anyone for a single job */
+	if ( n == 1 || _threads == 1 ){
+		for ( size_t i = 0; i < n; i++ ){
+			func(data, i);
+		}
+		return 0;
+	}
+
+	pthread_mutex_lock(&_lock);
+
+	/* another caller is running a batch */
+	while ( _func ){
+		pthread_cond_wait(&_idle, &_lock);
+	}
+
+	if ( _workers.empty() ){
+		start();
+	}
+
+	_func = func;
+	_data = data;
+	_n = n;
+	_next = 0;
+	_finished = 0;
+	_batch++;
+	pthread_cond_broadcast(&_wake);
+
+	work();
+
+	while ( _finished < _n ){
+		pthread_cond_wait(&_done, &_lock);
+	}
+
+	_func = NULL;
+	_data = NULL;
+	pthread_cond_signal(&_idle);
+	pthread_mutex_unlock(&_lock);
+
+	return 0;
+}
+
+void thread_pool::work(){
+	/* called with _lock held */
+	while ( _next < _n ){
+		size_t index = _next++;
+
+		pthread_mutex_unlock(&_lock);
+		_func(_data, index);
+		pthread_mutex_lock(&_lock);
+
+		if ( ++_finished == _n ){
+			pthread_cond_signal(&_done);
+		}
+	}
+}
+
+void* thread_pool::worker(void* arg){
+	thread_pool* pool = (thread_pool*)arg;
+	unsigned int batch = 0;
+
+	pthread_mutex_lock(&pool->_lock);
+
+	for (;;){
+		while ( !pool->_quit && pool->_batch == batch ){
+			pthread_cond_wait(&pool->_wake, &pool->_lock);
+		}
+
+		if ( pool->_quit ){
+			break;
+		}
+
+		batch = pool->_batch;
+		pool->work();
+	}
+
+	pthread_mutex_unlock(&pool->_lock);
+	return NULL;
+}
@@ -3,11 +3,15 @@
 #include <GL/glx.h>
 #include <cstdio>
 #include <cstring>
+#include <string>
+#include <vector>
 
 static int level = 1; /* verbosity level: 0-2 where 0 is quiet */
 static enum {
 	VALIDATE,
-	ENUMERATE
+	ENUMERATE,
+	BAKE,
+	PACK
 } mode = VALIDATE;
 
 #ifndef TESS_EVALUATION_SHADER
@@ -31,6 +35,9 @@ int parse(const char* path){
 		return ret;
 	}
 
+	/* read all sources in batches before they are preprocessed */
+	ep.prefetch();
+
 	if ( ( ret = ep.compile(&log) ) != 0 ){
 		fprintf(stderr, "Failed to parse '%s'.\n", path);
 		return ret;
@@ -77,6 +84,45 @@ int enumerate(const char* path){
 	return 0;
 }
 
+int bake(const char* path){
+	int ret;
+
+	glslfx::file_sink log(stderr);
+	glslfx::effect ep(path);
+	const std::string dst = std::string(path) + ".baked";
+
+	if ( ( ret = ep.parse() ) != 0 ){
+		fprintf(stderr, "Failed to parse '%s'.\n", path);
+		return ret;
+	}
+
+	if ( ( ret = ep.bake(dst, &log) ) != 0 ){
+		fprintf(stderr, "Failed to bake '%s'.\n", path);
+		return ret;
+	}
+
+	if ( level > 0 ){
+		printf("%s -> %s\n", path, dst.c_str());
+	}
+
+	return 0;
+}
+
+int pack(const std::string& archive, const std::vector<std::string>& files){
+	int ret;
+
+	if ( ( ret = glslfx::archive_provider::pack(archive, files) ) != 0 ){
+		fprintf(stderr, "Failed to write '%s': %s\n", archive.c_str(), ret > 0 ? strerror(ret) : "error");
+		return ret;
+	}
+
+	if ( level > 0 ){
+		printf("%s: %d files\n", archive.c_str(), (int)files.size());
+	}
+
+	return 0;
+}
+
 // Helper to check for extension string presence.  Adapted from:
 //   http://www.opengl.org/resources/features/OGLextensions/
 static bool isExtensionSupported(const char *extList, const char *extension){
@@ -207,10 +253,16 @@ void show_usage(){
 	fprintf(stdout, "  -v, --verbose\tin addition to warnings and errors, show eventual other\n"
 	                "\t\tmessages from the driver.\n");
 	fprintf(stdout, "      --enumerate\tenumerate the techniques and passes in an effect.\n");
+	fprintf(stdout, "      --bake\twrite the effect with expanded sources to FILE.baked,\n"
+	                "\t\tsee effect::load_baked.\n");
+	fprintf(stdout, "      --pack ARCHIVE FILE...\n"
+	                "\t\twrite all following files to an archive, see archive_provider.\n");
 	fprintf(stdout, "  -h, --help\tdisplay this help and exit.\n");
 }
 
 int run(int argc, const char* argv[]){
+	std::string archive;
+	std::vector<std::string> packed;
 	int ret = 0;
 
 	for ( int i = 1; i < argc; i++ ){
@@ -239,6 +291,16 @@ int run(int argc, const char* argv[]){
 						continue;
 					}
 
+					if ( strcmp(long_flag, "bake") == 0 ){
+						mode = BAKE;
+						continue;
+					}
+
+					if ( strcmp(long_flag, "pack") == 0 ){
+						mode = PACK;
+						continue;
+					}
+
 					/* fallthrough */
 
 				default:
@@ -250,12 +312,25 @@ int run(int argc, const char* argv[]){
 			switch ( mode ){
 				case VALIDATE: ret |= parse(arg); break;
 				case ENUMERATE: ret |= enumerate(arg); break;
+				case BAKE: ret |= bake(arg); break;
+				case PACK:
+					/* the first path is the archive, all following are packed */
+					if ( archive.empty() ){
+						archive = arg;
+					} else {
+						packed.push_back(arg);
+					}
+					continue;
 			}
 
 			mode = VALIDATE; /* reset mode */
 		}
 	}
 
+	if ( !archive.empty() ){
+		ret |= pack(archive, packed);
+	}
+
 	return ret;
 }
 
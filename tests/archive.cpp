@@ -0,0 +1,128 @@
+#include "check.h"
+#include <glslfx/glslfx.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+/**
+ * Archives packed from files on disk, loaded and read back through an
+ * effect after the files are removed. Corrupted archives are rejected.
+ */
+
+static std::string read_file(const std::string& path){
+	std::string data;
+	char buf[4096];
+	size_t n;
+
+	FILE* fp = fopen(path.c_str(), "rb");
+	while ( ( n = fread(buf, 1, sizeof(buf), fp) ) > 0 ){
+		data.append(buf, n);
+	}
+	fclose(fp);
+	return data;
+}
+
+/* load a damaged copy of an archive */
+static int load_damaged(const std::string& path, const std::string& data){
+	glslfx::archive_provider ar;
+	write_file(path, data);
+	return ar.load(path);
+}
+
+int main(){
+	const temp_dir tmp("archive");
+	const std::string& dir = tmp.path();
+	const std::string packed = dir + "/effects.pack";
+
+	write_file(dir + "/test.glslfx",
+	           "technique t {\n"
+	           "  pass p {\n"
+	           "    vertex: v.glsl\n"
+	           "    fragment: f.glsl\n"
+	           "  }\n"
+	           "}\n");
+	write_file(dir + "/v.glsl",
+	           "#version 120\n"
+	           "#include \"common.glsl\"\n"
+	           "void main(){ gl_Position = vec4(scale); }\n");
+	write_file(dir + "/f.glsl",
+	           "void main(){ gl_FragColor = vec4(1.0); }\n");
+	write_file(dir + "/common.glsl",
+	           "uniform float scale;\n");
+
+	/* the same file under two spellings is stored once */
+	std::vector<std::string> files;
+	files.push_back(dir + "/test.glslfx");
+	files.push_back(dir + "/v.glsl");
+	files.push_back(dir + "/./v.glsl");
+	files.push_back(dir + "/f.glsl");
+	files.push_back(dir + "/common.glsl");
+	check(glslfx::archive_provider::pack(packed, files) == 0);
+
+	/* a missing file fails the whole archive */
+	files.push_back(dir + "/missing.glsl");
+	check(glslfx::archive_provider::pack(dir + "/bad.pack", files) == ENOENT);
+	check(access((dir + "/bad.pack").c_str(), F_OK) != 0);
+
+	glslfx::archive_provider ar;
+	check(ar.load(packed) == 0);
+	check(ar.size() == 4);
+
+	glslfx::file_provider::file file;
+	check(ar.open(dir + "/common.glsl", file) == 0);
+	check(std::string(file.data, file.size) == "uniform float scale;\n");
+	ar.close(file);
+
+	glslfx::include_cache::identity id;
+	check(ar.stat(dir + "/v.glsl", id) == 0);
+	check(ar.stat(dir + "/missing.glsl", id) == ENOENT);
+	check(ar.open(dir + "/missing.glsl", file) == ENOENT);
+
+	/* effects read everything through the archive */
+	const std::string data = read_file(packed);
+	unlink((dir + "/test.glslfx").c_str());
+	unlink((dir + "/v.glsl").c_str());
+	unlink((dir + "/f.glsl").c_str());
+	unlink((dir + "/common.glsl").c_str());
+
+	{
+		glslfx::effect ep(dir + "/test.glslfx");
+		ep.set_file_provider(&ar);
+		check(ep.parse() == 0);
+
+		glslfx::technique* tech = ep.technique_get("t");
+		check(tech != NULL);
+
+		std::string src;
+		if ( tech ){
+			check(tech->pass_get("p")->source(GL_VERTEX_SHADER, src) == 0);
+			check(src.find("uniform float scale;") != std::string::npos);
+		}
+	}
+
+	/* damaged archives */
+	std::string damaged = data;
+	damaged[0] = 'X';
+	check(load_damaged(dir + "/damaged.pack", damaged) == glslfx::E_PARSE_ERROR);
+
+	damaged = data.substr(0, data.size() - 1);
+	check(load_damaged(dir + "/damaged.pack", damaged) == glslfx::E_PARSE_ERROR);
+
+	damaged = data.substr(0, 16);
+	check(load_damaged(dir + "/damaged.pack", damaged) == glslfx::E_PARSE_ERROR);
+
+	/* directory larger than the file (count follows magic, version,
+	 * endianess and size in the header) */
+	damaged = data;
+	memset(&damaged[24], 0x7f, 8);
+	check(load_damaged(dir + "/damaged.pack", damaged) == glslfx::E_PARSE_ERROR);
+
+	/* a failed load keeps the previous archive */
+	check(ar.load(dir + "/damaged.pack") == glslfx::E_PARSE_ERROR);
+	check(ar.size() == 4);
+
+	return check_result();
+}
@@ -0,0 +1,97 @@
+#include "check.h"
+#include <glslfx/glslfx.h>
+#include <stdio.h>
+#include <string>
+
+/**
+ * Effects baked and loaded back. A baked effect is used as is, without
+ * reading any shader source, while one built from files which have
+ * changed since (or a damaged one) falls back to parsing the fx-file.
+ */
+
+/**
+ * Load a baked effect and get the vertex source.
+ * @param baked Set to whenever the baked sources were used, ie. no source
+ *              file was read.
+ */
+static int load(const std::string& fx, const std::string& path, std::string& src, bool& baked){
+	glslfx::effect ep(fx);
+	int ret;
+
+	if ( ( ret = ep.load_baked(path) ) != 0 ){
+		return ret;
+	}
+
+	glslfx::technique* tech = ep.technique_get("t");
+	if ( !tech || !tech->pass_get("p") ){
+		return glslfx::E_NOT_FOUND;
+	}
+
+	ret = tech->pass_get("p")->source(GL_VERTEX_SHADER, src);
+	baked = ep.includes()->misses() == 0;
+	return ret;
+}
+
+int main(){
+	const temp_dir tmp("baked");
+	const std::string& dir = tmp.path();
+	const std::string fx = dir + "/test.glslfx";
+	const std::string path = dir + "/test.baked";
+
+	write_file(fx,
+	           "technique t {\n"
+	           "  pass p {\n"
+	           "    vertex: v.glsl\n"
+	           "    fragment: f.glsl\n"
+	           "  }\n"
+	           "}\n");
+	write_file(dir + "/v.glsl",
+	           "#version 120\n"
+	           "#include \"common.glsl\"\n"
+	           "void main(){ gl_Position = vec4(scale); }\n");
+	write_file(dir + "/f.glsl",
+	           "void main(){ gl_FragColor = vec4(1.0); }\n");
+	write_file(dir + "/common.glsl",
+	           "uniform float scale;\n");
+
+	{
+		glslfx::effect ep(fx);
+		check(ep.parse() == 0);
+		check(ep.bake(path, NULL) == 0);
+	}
+
+	std::string src;
+	bool baked = false;
+
+	/* unchanged */
+	check(load(fx, path, src, baked) == 0);
+	check(baked);
+	check(src.find("uniform float scale;") != std::string::npos);
+
+	/* an include changed since the effect was baked */
+	write_file(dir + "/common.glsl", "uniform float scale; uniform float bias;\n");
+	check(load(fx, path, src, baked) == 0);
+	check(!baked);
+	check(src.find("uniform float bias;") != std::string::npos);
+
+	/* baked again it is up to date */
+	{
+		glslfx::effect ep(fx);
+		check(ep.parse() == 0);
+		check(ep.bake(path, NULL) == 0);
+	}
+	check(load(fx, path, src, baked) == 0);
+	check(baked);
+	check(src.find("uniform float bias;") != std::string::npos);
+
+	/* damaged */
+	write_file(path, "GLSLFXB");
+	check(load(fx, path, src, baked) == 0);
+	check(!baked);
+
+	/* missing */
+	check(load(fx, dir + "/missing.baked", src, baked) == 0);
+	check(!baked);
+
+	return check_result();
+}
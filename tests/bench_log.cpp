@@ -0,0 +1,137 @@
+#include "info_log.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <string>
+
+/**
+ * Benchmark of the info log parsers over recorded driver logs. Each log is
+ * named after the vendor which produced it (ati.log, nvidia.log, mesa.log).
+ *
+ * Usage: tests-bench-log [ITERATIONS] [LOG]...
+ *
+ * Without any LOG the recorded logs in tests/logs are used, found through
+ * $srcdir or else the source tree the benchmark was built from.
+ */
+
+#ifndef TOP_SRCDIR
+#	error TOP_SRCDIR must be set to the top of the source tree
+#endif
+
+static const char* default_logs[] = {
+	"ati.log", "nvidia.log", "mesa.log", NULL
+};
+
+static double now(){
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static int read_file(const char* filename, std::string& dst){
+	FILE* fp = fopen(filename, "rb");
+	char buf[4096];
+	size_t n;
+
+	if ( !fp ){
+		return 1;
+	}
+
+	dst.clear();
+	while ( ( n = fread(buf, 1, sizeof(buf), fp) ) > 0 ){
+		dst.append(buf, n);
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+static glslfx::vendor_t vendor_from_filename(const char* filename){
+	const char* base = strrchr(filename, '/');
+	base = base ? base + 1 : filename;
+
+	if ( strncmp(base, "ati", 3) == 0 ) return glslfx::VENDOR_ATI;
+	if ( strncmp(base, "nvidia", 6) == 0 ) return glslfx::VENDOR_NVIDIA;
+	return glslfx::VENDOR_OTHER;
+}
+
+/**
+ * Parse all lines of a log once, the same way parse_log does.
+ * @return number of lines parsed as messages.
+ */
+static unsigned int parse(glslfx::info_parser func, const char* p, const char* end, unsigned int& lines){
+	unsigned int messages = 0;
+	glslfx::info_message msg;
+
+	while ( p < end ){
+		const char* eol = (const char*)memchr(p, '\n', end - p);
+		const char* next = eol ? eol + 1 : end;
+		if ( !eol ){
+			eol = end;
+		}
+
+		lines++;
+		if ( func(p, eol, msg) ){
+			messages++;
+		}
+
+		p = next;
+	}
+
+	return messages;
+}
+
+static int run(const char* filename, unsigned int iterations){
+	std::string data;
+
+	if ( read_file(filename, data) != 0 ){
+		fprintf(stderr, "%s: failed to read\n", filename);
+		return 1;
+	}
+
+	glslfx::info_parser func = glslfx::select_info_parser(vendor_from_filename(filename));
+	const char* begin = data.data();
+	const char* end = begin + data.size();
+	unsigned int lines = 0;
+	unsigned int messages = 0;
+
+	double t = now();
+	for ( unsigned int i = 0; i < iterations; i++ ){
+		messages = parse(func, begin, end, lines);
+	}
+	t = now() - t;
+
+	printf("%-24s %4u/%-4u messages %10.0f lines/s %8.1f MB/s\n",
+		   filename, messages, lines / iterations,
+		   lines / t, data.size() * (double)iterations / t / (1024.0 * 1024.0));
+
+	return 0;
+}
+
+int main(int argc, char* argv[]){
+	unsigned int iterations = 100000;
+	int ret = 0;
+	int first = 1;
+
+	if ( argc > 1 && atoi(argv[1]) > 0 ){
+		iterations = atoi(argv[1]);
+		first = 2;
+	}
+
+	/* recorded logs shipped with the tests */
+	if ( first >= argc ){
+		const char* srcdir = getenv("srcdir");
+		for ( int i = 0; default_logs[i]; i++ ){
+			std::string filename = std::string(srcdir ? srcdir : TOP_SRCDIR) + "/tests/logs/" + default_logs[i];
+			ret |= run(filename.c_str(), iterations);
+		}
+		return ret;
+	}
+
+	for ( int i = first; i < argc; i++ ){
+		ret |= run(argv[i], iterations);
+	}
+
+	return ret;
+}
@@ -0,0 +1,70 @@
+#ifndef __GLSL_FX_TESTS_CHECK_H
+#define __GLSL_FX_TESTS_CHECK_H
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+/**
+ * Scaffolding shared by the tests. check() reports and counts failed
+ * expectations without stopping the test, check_result() gives the exit
+ * status of the test. Files are written into a temp_dir which is removed
+ * along with everything in it when the test is done.
+ */
+
+static int failures = 0;
+
+#define check(expr) do { \
+		if ( !(expr) ){ \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+			failures++; \
+		} \
+	} while (0)
+
+static inline int check_result(){
+	if ( failures > 0 ){
+		fprintf(stderr, "%d checks failed\n", failures);
+		return 1;
+	}
+
+	return 0;
+}
+
+static inline void write_file(const std::string& path, const std::string& data){
+	FILE* fp = fopen(path.c_str(), "wb");
+	fwrite(data.data(), 1, data.size(), fp);
+	fclose(fp);
+}
+
+static inline int remove_entry(const char* path, const struct stat*, int, struct FTW*){
+	return remove(path);
+}
+
+class temp_dir {
+public:
+	explicit temp_dir(const char* name)
+		: _path(std::string("/tmp/glslfx-") + name + "-XXXXXX") {
+
+		if ( !mkdtemp(&_path[0]) ){
+			perror("mkdtemp");
+			exit(1);
+		}
+	}
+
+	~temp_dir(){
+		nftw(_path.c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+	}
+
+	const std::string& path() const {
+		return _path;
+	}
+
+private:
+	temp_dir(const temp_dir&);
+	temp_dir& operator=(const temp_dir&);
+
+	std::string _path;
+};
+
+#endif /* __GLSL_FX_TESTS_CHECK_H */
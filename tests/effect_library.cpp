@@ -0,0 +1,132 @@
+#include "check.h"
+#include <glslfx/glslfx.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string>
+
+/**
+ * A directory of effects loaded at once. Broken and missing files are
+ * reported in the order they were added and left out, files added twice
+ * are loaded once. The loaded effects share an include cache and a thread
+ * pool and are used from several threads at once.
+ */
+
+enum { ROUNDS = 50 };
+
+typedef struct {
+	glslfx::effect* ep;
+	int ret;
+} worker;
+
+static void* run(void* arg){
+	worker* w = (worker*)arg;
+
+	for ( unsigned int i = 0; i < ROUNDS && w->ret == 0; i++ ){
+		std::string src;
+
+		if ( ( w->ret = w->ep->prefetch() ) != 0 ){
+			break;
+		}
+
+		w->ret = w->ep->technique_get("t")->pass_get("p")->source(GL_VERTEX_SHADER, src);
+		if ( w->ret == 0 && src.find("uniform float scale;") == std::string::npos ){
+			w->ret = glslfx::E_NOT_FOUND;
+		}
+	}
+
+	return NULL;
+}
+
+static std::string effect_source(const char* vertex){
+	return std::string("technique t {\n"
+	                   "  pass p {\n"
+	                   "    vertex: ") + vertex + "\n"
+	       "    fragment: f.glsl\n"
+	       "  }\n"
+	       "}\n";
+}
+
+int main(){
+	const temp_dir tmp("effect-library");
+	const std::string& dir = tmp.path();
+
+	write_file(dir + "/b.glslfx", effect_source("w.glsl"));
+	write_file(dir + "/a.glslfx", effect_source("v.glsl"));
+	write_file(dir + "/broken.glslfx", "technique {\n");
+	write_file(dir + "/notes.txt", "not an effect\n");
+	write_file(dir + "/v.glsl",
+	           "#include \"common.glsl\"\n"
+	           "void main(){ gl_Position = vec4(scale); }\n");
+	write_file(dir + "/w.glsl",
+	           "#include \"common.glsl\"\n"
+	           "void main(){ gl_Position = vec4(scale * 2.0); }\n");
+	write_file(dir + "/f.glsl",
+	           "void main(){ gl_FragColor = vec4(1.0); }\n");
+	write_file(dir + "/common.glsl",
+	           "uniform float scale;\n");
+
+	glslfx::effect_library lib;
+	glslfx::log log;
+
+	lib.set_threads(4);
+	check(lib.add_directory(dir) == 0);
+	check(lib.add_directory(dir + "/missing") == ENOENT);
+	lib.add(dir + "/a.glslfx");
+	lib.add(dir + "/missing.glslfx");
+
+	/* the first failure is returned, all are logged in order */
+	check(lib.load(&log) == glslfx::E_PARSE_ERROR);
+	check(log.size() == 2);
+	if ( log.size() == 2 ){
+		glslfx::log::const_iterator it = log.begin();
+		check(log.file(*it).str() == dir + "/broken.glslfx");
+		++it;
+		check(log.file(*it).str() == dir + "/missing.glslfx");
+	}
+
+	/* in order of their names, the duplicate loaded once */
+	check(lib.size() == 2);
+	if ( lib.size() == 2 ){
+		check(lib.begin()[0] == lib.get(dir + "/a.glslfx"));
+		check(lib.begin()[1] == lib.get(dir + "/b.glslfx"));
+	}
+	check(lib.get(dir + "/a.glslfx") != NULL);
+	check(lib.get(dir + "/broken.glslfx") == NULL);
+	check(lib.get(dir + "/missing.glslfx") == NULL);
+	check(lib.get(dir + "/notes.txt") == NULL);
+
+	/* loaded effects are not loaded again */
+	lib.add(dir + "/a.glslfx");
+	check(lib.load(NULL) == 0);
+	check(lib.size() == 2);
+
+	for ( glslfx::effect_library::const_iterator it = lib.begin(); it != lib.end(); ++it ){
+		check((*it)->includes() == lib.includes());
+	}
+
+	/* effects sharing the cache and the pool, used from separate threads */
+	worker w[2];
+	pthread_t threads[2];
+	for ( unsigned int i = 0; i < 2 && lib.size() == 2; i++ ){
+		w[i].ep = lib.begin()[i];
+		w[i].ret = 0;
+		check(pthread_create(&threads[i], NULL, run, &w[i]) == 0);
+	}
+	for ( unsigned int i = 0; i < 2 && lib.size() == 2; i++ ){
+		pthread_join(threads[i], NULL);
+		check(w[i].ret == 0);
+	}
+
+	/* the shared include is cached once for both */
+	const unsigned int misses = lib.includes()->misses();
+	std::string src;
+	check(lib.get(dir + "/b.glslfx")->technique_get("t")->pass_get("p")->source(GL_VERTEX_SHADER, src) == 0);
+	check(src.find("scale * 2.0") != std::string::npos);
+	check(lib.includes()->misses() == misses);
+
+	/* effects follow the library to a new pool */
+	lib.set_threads(2);
+	check(lib.get(dir + "/a.glslfx")->prefetch() == 0);
+
+	return check_result();
+}
@@ -0,0 +1,101 @@
+#include "check.h"
+#include "expression.h"
+#include <glslfx/glslfx.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Preprocessor expressions, evaluated without a GL context.
+ */
+
+static glslfx::macro_map macros;
+
+static void define(const char* name, const char* value, bool function = false, bool uncertain = false){
+	glslfx::macro tmp;
+	tmp.value = value;
+	tmp.function = function;
+	tmp.uncertain = uncertain;
+	macros[name] = tmp;
+}
+
+/* evaluate expecting a value */
+static bool value(const char* expr, long expected){
+	long result = -1;
+	return glslfx::eval_expression(expr, expr + strlen(expr), macros, 7, result) == 0 && result == expected;
+}
+
+static int status(const char* expr){
+	long result;
+	return glslfx::eval_expression(expr, expr + strlen(expr), macros, 7, result);
+}
+
+int main(){
+	define("ONE", "1");
+	define("TWO", "ONE + ONE");
+	define("SELF", "SELF + 1");
+	define("MAX", "((a) > (b) ? (a) : (b))", true);
+	define("MAYBE", "1", false, true);
+	define("__VERSION__", "330");
+
+	char max[32];
+	snprintf(max, sizeof(max), "%ld", LONG_MAX);
+	define("LMAX", max);
+	define("LMIN", "(-LMAX - 1)");
+
+	/* arithmetic and precedence */
+	check(value("1 + 2 * 3", 7));
+	check(value("(1 + 2) * 3", 9));
+	check(value("-4 / 2 + 10 % 3", -1));
+	check(value("1 << 4 | 1", 17));
+	check(value("!0 && ~0 == -1", 1));
+	check(value("1 ? 2 : 3", 2));
+	check(value("0x10 == 16", 1));
+	check(status("1 / 0") == glslfx::E_PARSE_ERROR);
+	check(status("(1 + 2") == glslfx::E_PARSE_ERROR);
+	check(status("") == glslfx::E_PARSE_ERROR);
+	check(value("1 /* \xe2\x80\x94 */ + 1", 2));
+	check(status("1 + \xe2\x80\x94") == glslfx::E_PARSE_ERROR);
+
+	/* overflow wraps, shifts out of range are errors */
+	check(value("LMAX + 1 == LMIN", 1));
+	check(value("LMIN - 1 == LMAX", 1));
+	check(value("LMAX * 2", -2));
+	check(value("-LMIN == LMIN", 1));
+	check(value("LMIN / -1 == LMIN", 1));
+	check(value("LMIN % -1", 0));
+	check(value("-1 << 1", -2));
+	check(value("-8 >> 1", -4));
+	check(status("1 << -1") == glslfx::E_PARSE_ERROR);
+	check(status("1 >> 1000") == glslfx::E_PARSE_ERROR);
+	check(value("0 && 1 << 1000", 0));
+
+	/* macros */
+	check(value("TWO * 3", 4)); /* textual, not (1 + 1) * 3 */
+	check(value("defined(ONE) && !defined UNDEFINED", 1));
+	check(value("UNDEFINED", 0));
+	check(value("SELF", 1));
+	check(value("__VERSION__ >= 300", 1));
+	check(value("__LINE__", 7));
+	check(value("defined(__LINE__)", 1));
+
+	/* names only the driver knows */
+	check(status("GL_ES") == glslfx::EXPR_DEFERRED);
+	check(status("defined(GL_ARB_gpu_shader5)") == glslfx::EXPR_DEFERRED);
+	check(status("__FILE__ == 0") == glslfx::EXPR_DEFERRED);
+	check(status("MAYBE") == glslfx::EXPR_DEFERRED);
+	check(status("defined(MAYBE)") == glslfx::EXPR_DEFERRED);
+	check(status("MAX(1, 2) > 1") == glslfx::EXPR_DEFERRED);
+	check(status("MAX(1, 2") == glslfx::E_PARSE_ERROR);
+
+	/* unknown operands which are never evaluated */
+	check(value("0 && GL_ES", 0));
+	check(value("1 || defined(GL_ARB_gpu_shader5)", 1));
+	check(value("GL_ES && 0", 0));
+	check(value("GL_ES || 1", 1));
+	check(value("1 ? 5 : GL_ES", 5));
+	check(status("GL_ES ? 1 : 2") == glslfx::EXPR_DEFERRED);
+	check(status("GL_ES + 0") == glslfx::EXPR_DEFERRED);
+
+	return check_result();
+}
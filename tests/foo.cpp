@@ -122,70 +122,76 @@ void resize(int width, int height){
 	glLoadIdentity();
 }
 
-int main(int argc, const char* argv[]){
-	int ret = 0;
-	int width = 800, height = 600;
-	bool run = false;
-
+/**
+ * Load the effect and render it until the window is closed. The effect
+ * deletes its programs when destroyed so it must go before the context.
+ */
+static int run_effect(glslfx::log& log){
 	glslfx::effect ep(src("simple.glslfx"));
-	glslfx::log log;
-
-	SDL_Init(SDL_INIT_VIDEO);
-	SDL_SetVideoMode(width, height,0,SDL_OPENGL|SDL_DOUBLEBUF);
-
-	glewInit();
-
-	setup();
-	resize(width, height);
-
-	/* initialize library */
-	glslfx_init();
+	bool run = true;
 
 	/* parse effect */
 	if ( ep.parse() != 0 ){
-		ret = -1;
-		goto error;
+		return -1;
 	}
 
 	/* compile all techniques and their passes */
 	if ( ep.compile(&log) != 0 ){
-		ret = -1;
-		goto error;
+		return -1;
 	}
 
 	/* get one of the techniques */
 	if ( ( tech = ep.technique_get("simple") ) == NULL ){
-		ret = -1;
-		goto error;
+		return -1;
 	}
 
 	/* make sure the effect is valid */
 	if ( !ep.is_valid() ){
-		ret = -1;
-		goto error;
+		return -1;
 	}
 
 	/* set sample layout */
 	ep.set_layout(layout, sizeof(vertex_t), 2);
 
-	run = true;
 	while ( run ){
 		render();
 		input(run);
 	}
 
- error:
+	return 0;
+}
+
+int main(int argc, const char* argv[]){
+	int ret = 0;
+	int width = 800, height = 600;
+
+	glslfx::log log;
+
+	SDL_Init(SDL_INIT_VIDEO);
+	SDL_SetVideoMode(width, height,0,SDL_OPENGL|SDL_DOUBLEBUF);
+
+	glewInit();
+
+	setup();
+	resize(width, height);
+
+	/* initialize library */
+	glslfx_init();
+
+	ret = run_effect(log);
+
 	/* show log messages */
 	for ( glslfx::log::iterator it = log.begin(); it != log.end(); ++it ){
-		glslfx::log::entry entry = *it;
+		const glslfx::log::entry& entry = *it;
 
-		if ( entry.generic ){
-			fprintf(stderr, "%s\n", entry.message.c_str());
+		/* all strings from the log are null-terminated */
+		if ( entry.severity == glslfx::SEVERITY_NONE ){
+			fprintf(stderr, "%s\n", log.text(entry).data());
 		} else {
 			fprintf(stderr, "%s:%d %s %s: %s\n",
-					entry.file.c_str(), entry.line,
-					entry.severity.c_str(), entry.ref.c_str(),
-					entry.message.c_str());
+					log.file(entry).data(), entry.line,
+					glslfx::log::severity_name(entry.severity), log.ref(entry).data(),
+					log.text(entry).data());
 		}
 	}
 
@@ -0,0 +1,99 @@
+#ifndef __GLSL_FX_TESTS_GL_MOCK_H
+#define __GLSL_FX_TESTS_GL_MOCK_H
+
+#include <GL/glew.h>
+#include <string.h>
+
+/**
+ * Minimal stand-in for a GL driver so passes can be built without a
+ * context. Entry points loaded by GLEW are replaced by gl_mock_install(),
+ * core 1.1 functions are defined here and take precedence over libGL.
+ * Programs are numbered from 1 and shaders from 0x10000, every shader
+ * compiles and every program links. The info logs returned for programs
+ * and shaders can be set and the number of objects not yet deleted is
+ * counted.
+ */
+
+static const GLuint gl_mock_first_shader = 0x10000;
+static GLuint gl_mock_next = 1;
+static GLuint gl_mock_next_shader = gl_mock_first_shader;
+static const char* gl_mock_program_log = "";
+static const char* gl_mock_shader_log = "";
+static unsigned int gl_mock_links = 0;
+static unsigned int gl_mock_live_programs = 0;
+static unsigned int gl_mock_live_shaders = 0;
+
+extern "C" const GLubyte* glGetString(GLenum){
+	return (const GLubyte*)"glslfx mock";
+}
+
+extern "C" void glGetFloatv(GLenum, GLfloat* dst){
+	memset(dst, 0, sizeof(GLfloat) * 16);
+}
+
+static GLuint GLAPIENTRY mock_create(){ gl_mock_live_programs++; return gl_mock_next++; }
+static GLuint GLAPIENTRY mock_create_shader(GLenum){ gl_mock_live_shaders++; return gl_mock_next_shader++; }
+static void GLAPIENTRY mock_delete_program(GLuint id){ if ( id != 0 ) gl_mock_live_programs--; }
+static void GLAPIENTRY mock_delete_shader(GLuint id){ if ( id != 0 ) gl_mock_live_shaders--; }
+static void GLAPIENTRY mock_shader_source(GLuint, GLsizei, const GLchar* const*, const GLint*){}
+static void GLAPIENTRY mock_object(GLuint){}
+static void GLAPIENTRY mock_attach(GLuint, GLuint){}
+static void GLAPIENTRY mock_link(GLuint){ gl_mock_links++; }
+static void GLAPIENTRY mock_bind_attrib(GLuint, GLuint, const GLchar*){}
+static GLint GLAPIENTRY mock_location(GLuint, const GLchar*){ return -1; }
+static void GLAPIENTRY mock_uniform(GLint, GLsizei, GLboolean, const GLfloat*){}
+static void GLAPIENTRY mock_attrib_array(GLuint){}
+static void GLAPIENTRY mock_attrib_pointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*){}
+static GLboolean GLAPIENTRY mock_is_shader(GLuint id){ return id >= gl_mock_first_shader; }
+
+static void GLAPIENTRY mock_shader_iv(GLuint, GLenum pname, GLint* dst){
+	*dst = pname == GL_INFO_LOG_LENGTH ? (GLint)strlen(gl_mock_shader_log) : GL_TRUE;
+}
+
+static void GLAPIENTRY mock_program_iv(GLuint, GLenum pname, GLint* dst){
+	*dst = pname == GL_INFO_LOG_LENGTH ? (GLint)strlen(gl_mock_program_log) : GL_TRUE;
+}
+
+static void mock_copy_log(const char* src, GLsizei size, GLsizei* length, GLchar* dst){
+	GLsizei n = (GLsizei)strlen(src);
+	if ( n > size ){
+		n = size;
+	}
+	memcpy(dst, src, n);
+	*length = n;
+}
+
+static void GLAPIENTRY mock_program_log(GLuint, GLsizei size, GLsizei* length, GLchar* dst){
+	mock_copy_log(gl_mock_program_log, size, length, dst);
+}
+
+static void GLAPIENTRY mock_shader_log(GLuint, GLsizei size, GLsizei* length, GLchar* dst){
+	mock_copy_log(gl_mock_shader_log, size, length, dst);
+}
+
+static void gl_mock_install(){
+	glCreateProgram = mock_create;
+	glCreateShader = mock_create_shader;
+	glShaderSource = mock_shader_source;
+	glCompileShader = mock_object;
+	glDeleteShader = mock_delete_shader;
+	glDeleteProgram = mock_delete_program;
+	glValidateProgram = mock_object;
+	glUseProgram = mock_object;
+	glAttachShader = mock_attach;
+	glLinkProgram = mock_link;
+	glBindAttribLocation = mock_bind_attrib;
+	glGetAttribLocation = mock_location;
+	glGetUniformLocation = mock_location;
+	glUniformMatrix4fv = mock_uniform;
+	glEnableVertexAttribArray = mock_attrib_array;
+	glDisableVertexAttribArray = mock_attrib_array;
+	glVertexAttribPointer = mock_attrib_pointer;
+	glIsShader = mock_is_shader;
+	glGetShaderiv = mock_shader_iv;
+	glGetProgramiv = mock_program_iv;
+	glGetShaderInfoLog = mock_shader_log;
+	glGetProgramInfoLog = mock_program_log;
+}
+
+#endif /* __GLSL_FX_TESTS_GL_MOCK_H */
@@ -0,0 +1,126 @@
+#include "check.h"
+#include "minify.h"
+#include <glslfx/glslfx.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+/**
+ * Minified sources and their line maps, without a GL context. All input
+ * lines are mapped to lines 1.. of a single file.
+ */
+
+static const unsigned int file = 7;
+
+static std::string minify(const char* in, unsigned int flags, glslfx::source_list& dst){
+	glslfx::source_list src;
+	unsigned int lines = 0;
+	std::string out;
+
+	for ( const char* p = in; *p; p++ ){
+		if ( *p == '\n' ) lines++;
+	}
+
+	src.append(in, strlen(in));
+	src.lines().append(file, 1, lines);
+	glslfx::minify(src, flags, dst);
+	dst.str(out);
+	return out;
+}
+
+/* origin of a line in the minified source */
+static unsigned int origin(const glslfx::source_list& src, unsigned int line){
+	unsigned int handle, src_line;
+	if ( src.lines().find(line, handle, src_line) != 0 || handle != file ){
+		return 0;
+	}
+	return src_line;
+}
+
+int main(){
+	glslfx::source_list dst;
+
+	/* comments, blank lines and whitespace */
+	check(minify("#version 120\n"
+	             "\n"
+	             "float  a = 1.0 ;  // trailing\n"
+	             "/* block\n"
+	             "   comment */ float b = a  -  -1.0;\n"
+	             "void main ( ) {\n"
+	             "  gl_FragColor = vec4 ( a );\n"
+	             "}\n", glslfx::MINIFY_WHITESPACE, dst) ==
+	      "#version 120\n"
+	      "float a=1.0;\n"
+	      "float b=a- -1.0;\n"
+	      "void main(){\n"
+	      "gl_FragColor=vec4(a);\n"
+	      "}\n");
+	check(dst.lines().lines() == 6);
+	check(origin(dst, 1) == 1);
+	check(origin(dst, 2) == 3);
+	check(origin(dst, 3) == 5);
+	check(origin(dst, 6) == 8);
+
+	/* directives keep their spacing, continued lines are untouched */
+	check(minify("#define MAX(a, b)  ((a) > (b) ? (a) : (b))\n"
+	             "#if defined(FOO) \\\n"
+	             "  && 1\n"
+	             "int c;\n"
+	             "#endif\n", glslfx::MINIFY_WHITESPACE, dst) ==
+	      "#define MAX(a, b) ((a) > (b) ? (a) : (b))\n"
+	      "#if defined(FOO) \\\n"
+	      "  && 1\n"
+	      "int c;\n"
+	      "#endif\n");
+	check(origin(dst, 3) == 3);
+
+	/* unreachable functions */
+	check(minify("float unused(float x){ return x; }\n"
+	             "float used(float x){ return helper(x); }\n"
+	             "float helper(float x){ return x * 2.0; }\n"
+	             "void main(){ gl_FragColor = vec4(used(1.0)); }\n",
+	             glslfx::MINIFY_WHITESPACE | glslfx::MINIFY_DEAD_FUNCTIONS, dst) ==
+	      "float used(float x){return helper(x);}\n"
+	      "float helper(float x){return x*2.0;}\n"
+	      "void main(){gl_FragColor=vec4(used(1.0));}\n");
+	check(origin(dst, 1) == 2);
+
+	/* only whitespace unless asked for */
+	check(minify("float unused(float x){ return x; }\n"
+	             "void main(){ }\n", glslfx::MINIFY_WHITESPACE, dst) ==
+	      "float unused(float x){return x;}\n"
+	      "void main(){}\n");
+
+	/* conditionals left to the driver may split definitions */
+	check(minify("float unused(float x){ return x; }\n"
+	             "#ifdef GL_ES\n"
+	             "precision mediump float;\n"
+	             "#endif\n"
+	             "void main(){ }\n",
+	             glslfx::MINIFY_WHITESPACE | glslfx::MINIFY_DEAD_FUNCTIONS, dst).find("unused") != std::string::npos);
+	check(minify("float unused(float x){ return x; }\n"
+	             "#  ifdef GL_ES\n"
+	             "precision mediump float;\n"
+	             "#  endif\n"
+	             "void main(){ }\n",
+	             glslfx::MINIFY_WHITESPACE | glslfx::MINIFY_DEAD_FUNCTIONS, dst).find("unused") != std::string::npos);
+
+	/* lines outside the line map have no origin */
+	{
+		glslfx::source_list src;
+		unsigned int handle, line;
+
+		src.append("float a;\nfloat b;\n", 18);
+		src.lines().append(file, 1, 1);
+		glslfx::minify(src, glslfx::MINIFY_WHITESPACE, dst);
+		check(dst.lines().find(1, handle, line) == 0 && handle == file && line == 1);
+		check(dst.lines().find(2, handle, line) == 0 && handle == glslfx::line_map::unmapped);
+	}
+
+	/* without main nothing is known to be reachable */
+	check(minify("float f(float x){ return x; }\n",
+	             glslfx::MINIFY_WHITESPACE | glslfx::MINIFY_DEAD_FUNCTIONS, dst) ==
+	      "float f(float x){return x;}\n");
+
+	return check_result();
+}
@@ -0,0 +1,65 @@
+#include "check.h"
+#include "name_index.h"
+#include <glslfx/glslfx.h>
+#include <stdio.h>
+#include <string>
+
+/**
+ * Hashed name lookup used for technique and pass names, and the handles
+ * of techniques and passes.
+ */
+
+static std::string numbered(const char* prefix, unsigned int i){
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%s%u", prefix, i);
+	return buf;
+}
+
+static void test_name_index(){
+	glslfx::name_index index;
+	unsigned int id;
+
+	check(index.insert("shadow", 0) == 0);
+	check(index.insert("forward", 1) == 0);
+	check(index.insert("shadow", 2) == glslfx::E_NOT_SET);
+	check(index.size() == 2);
+	check(index.find("shadow", id) == 0 && id == 0);
+	check(index.find(glslfx::string_view("forward_base", 7), id) == 0 && id == 1);
+	check(index.find("deferred", id) == glslfx::E_NOT_FOUND);
+	check(index.find("", id) == glslfx::E_NOT_FOUND);
+
+	/* ids survive growing the index */
+	for ( unsigned int i = 0; i < 1000; i++ ){
+		check(index.insert(numbered("pass", i), 100 + i) == 0);
+	}
+	check(index.size() == 1002);
+	for ( unsigned int i = 0; i < 1000; i++ ){
+		check(index.find(numbered("pass", i), id) == 0 && id == 100 + i);
+	}
+	check(index.find("shadow", id) == 0 && id == 0);
+}
+
+static void test_techniques(){
+	glslfx::effect ep("test.glslfx");
+	glslfx::technique_id id;
+
+	glslfx::technique* a = ep.technique_new("a");
+	glslfx::technique* b = ep.technique_new("b");
+	a->pass_new("p");
+
+	/* declared again, passes are added to the first technique */
+	check(ep.technique_new("a") == a);
+	a->pass_new("q");
+
+	check(ep.technique_count() == 2);
+	check(ep.technique_find("a", id) == 0 && ep.technique_at(id) == a);
+	check(ep.technique_find("b", id) == 0 && ep.technique_at(id) == b);
+	check(a->pass_get("p") != NULL && a->pass_get("q") != NULL);
+}
+
+int main(){
+	test_name_index();
+	test_techniques();
+
+	return check_result();
+}
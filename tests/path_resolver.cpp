@@ -0,0 +1,69 @@
+#include "check.h"
+#include "path_resolver.h"
+#include <glslfx/glslfx.h>
+#include <sys/stat.h>
+#include <string>
+
+/**
+ * Canonicalization and cached resolution of paths through a base
+ * directory and include search paths.
+ */
+
+static void test_canonicalize(){
+	typedef glslfx::path_resolver r;
+	check(r::canonicalize("a/b/../c") == "a/c");
+	check(r::canonicalize("./a//b/./") == "a/b");
+	check(r::canonicalize("/a/../../b") == "/b");
+	check(r::canonicalize("../a/../../b") == "../../b");
+	check(r::canonicalize("a/..") == ".");
+	check(r::canonicalize("") == ".");
+	check(r::canonicalize("/") == "/");
+}
+
+static void test_resolver(){
+	const temp_dir tmp("path-resolver");
+	const std::string& dir = tmp.path();
+
+	mkdir((dir + "/base").c_str(), 0700);
+	mkdir((dir + "/lib").c_str(), 0700);
+	mkdir((dir + "/lib2").c_str(), 0700);
+	write_file(dir + "/base/local.glsl", "");
+	write_file(dir + "/lib/common.glsl", "");
+	write_file(dir + "/lib2/common.glsl", "");
+	write_file(dir + "/lib2/extra.glsl", "");
+
+	glslfx::path_resolver resolver;
+	resolver.set_base(dir + "/./base/");
+
+	/* without search paths everything is relative to the base */
+	check(resolver.resolve("local.glsl") == dir + "/base/local.glsl");
+	check(resolver.resolve("common.glsl") == dir + "/base/common.glsl");
+	check(resolver.resolve("../lib/common.glsl") == dir + "/lib/common.glsl");
+	check(resolver.resolve("/abs/./x.glsl") == "/abs/x.glsl");
+
+	/* search paths in order, relative ones from the base */
+	resolver.add_search_path("../lib");
+	resolver.add_search_path(dir + "/lib2");
+	check(resolver.search_paths().size() == 2 && resolver.search_paths()[0] == dir + "/lib");
+	check(resolver.resolve("local.glsl") == dir + "/base/local.glsl");
+	check(resolver.resolve("common.glsl") == dir + "/lib/common.glsl");
+	check(resolver.resolve("extra.glsl") == dir + "/lib2/extra.glsl");
+	check(resolver.resolve("missing.glsl") == dir + "/base/missing.glsl");
+
+	/* cached until cleared, including files which weren't found */
+	const unsigned int misses = resolver.misses();
+	check(resolver.resolve("missing.glsl") == dir + "/base/missing.glsl");
+	check(resolver.misses() == misses && resolver.hits() > 0);
+
+	write_file(dir + "/lib2/missing.glsl", "");
+	check(resolver.resolve("missing.glsl") == dir + "/base/missing.glsl");
+	resolver.clear();
+	check(resolver.resolve("missing.glsl") == dir + "/lib2/missing.glsl");
+}
+
+int main(){
+	test_canonicalize();
+	test_resolver();
+
+	return check_result();
+}
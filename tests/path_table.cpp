@@ -0,0 +1,70 @@
+#include "check.h"
+#include "path_table.h"
+#include <glslfx/glslfx.h>
+#include <stdio.h>
+#include <string>
+
+/**
+ * Interned paths: handles are stable and stored strings stay in place
+ * while the table grows. Every effect has a table of its own.
+ */
+
+static std::string numbered(const char* prefix, unsigned int i){
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%s%u", prefix, i);
+	return buf;
+}
+
+static void test_table(){
+	glslfx::path_table table;
+	unsigned int a, b, c;
+
+	check(table.store("a.glsl", a) == 0);
+	check(table.store("b.glsl", b) == 0);
+	check(table.store("a.glsl", c) == 0);
+	check(a == 0 && b == 1 && c == a);
+	check(table.size() == 2);
+	check(table.find("b.glsl", c) == 0 && c == b);
+	check(table.find("c.glsl", c) == glslfx::E_NOT_FOUND);
+	check(table.retrieve(b) && *table.retrieve(b) == "b.glsl");
+	check(table.retrieve(2) == NULL);
+
+	/* handles and strings stay valid while the index grows */
+	const std::string* first = table.retrieve(a);
+	for ( unsigned int i = 0; i < 5000; i++ ){
+		unsigned int handle;
+		check(table.store(numbered("dir/file", i), handle) == 0 && handle == i + 2);
+	}
+	check(table.size() == 5002);
+	check(table.retrieve(a) == first && *first == "a.glsl");
+	check(table.find("dir/file4321", c) == 0 && c == 4323);
+}
+
+static void test_effect_tables(){
+	glslfx::effect a("a.glslfx");
+	std::string path;
+	unsigned int x, y;
+
+	{
+		glslfx::effect b("b.glslfx");
+		unsigned int z;
+
+		check(a.path_store("x.glsl", x) == 0);
+		check(b.path_store("y.glsl", y) == 0);
+		check(b.path_store("x.glsl", z) == 0 && z != y);
+		check(b.path_retrieve(y, path) == 0 && path == "y.glsl");
+		check(b.path_retrieve(z, path) == 0 && path == "x.glsl");
+	}
+
+	/* handles of one effect mean nothing to another */
+	check(a.path_retrieve(x, path) == 0 && path == "x.glsl");
+	check(a.path_retrieve(x + 1, path) == glslfx::E_NOT_FOUND);
+	check(a.path_store("y.glsl", y) == 0 && y == x + 1);
+}
+
+int main(){
+	test_table();
+	test_effect_tables();
+
+	return check_result();
+}
@@ -0,0 +1,109 @@
+#include "check.h"
+#include "prefetch.h"
+#include <glslfx/glslfx.h>
+#include <errno.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+/**
+ * Files read in batches, through io_uring where available and through the
+ * thread pool otherwise (forced, so both run on any kernel). After an
+ * effect is prefetched every source and include is served by the cache.
+ */
+
+static void test_reader(const std::string& dir, bool uring){
+	glslfx::thread_pool pool(2);
+	glslfx::batch_reader reader(&pool, uring);
+	std::vector<glslfx::batch_reader::request> requests;
+	static const char* names[] = {"v.glsl", "common.glsl", "deep.glsl", "missing.glsl", NULL};
+
+	if ( !uring ){
+		check(!reader.uring());
+	}
+
+	for ( unsigned int i = 0; names[i]; i++ ){
+		glslfx::batch_reader::request tmp;
+		tmp.path = dir + "/" + names[i];
+		tmp.file = NULL;
+		tmp.error = 0;
+		requests.push_back(tmp);
+	}
+
+	reader.read(requests);
+
+	check(requests[0].file && std::string(requests[0].file->data(), requests[0].file->size()).find("#include \"common.glsl\"") == 0);
+	check(requests[1].file && std::string(requests[1].file->data(), requests[1].file->size()) == "#include \"deep.glsl\"\n");
+	check(requests[2].file && std::string(requests[2].file->data(), requests[2].file->size()) == "uniform float scale;\n");
+	check(requests[3].file == NULL && requests[3].error == ENOENT);
+
+	for ( std::vector<glslfx::batch_reader::request>::iterator it = requests.begin(); it != requests.end(); ++it ){
+		delete it->file;
+	}
+}
+
+static glslfx::effect* create(const std::string& dir){
+	glslfx::effect* ep = new glslfx::effect(dir + "/test.glslfx");
+	glslfx::pass* p = ep->technique_new("t")->pass_new("p");
+	p->set_path(GL_VERTEX_SHADER, "v.glsl");
+	p->set_path(GL_FRAGMENT_SHADER, "f.glsl");
+	return ep;
+}
+
+/* prefetch and check that sources are expanded from the cache alone */
+static void test_effect(glslfx::effect* ep){
+	std::string src;
+
+	check(ep->prefetch() == 0);
+	const unsigned int misses = ep->includes()->misses();
+
+	glslfx::pass* p = ep->technique_get("t")->pass_get("p");
+	check(p->source(GL_VERTEX_SHADER, src) == 0);
+	check(src.find("uniform float scale;") != std::string::npos);
+	check(p->source(GL_FRAGMENT_SHADER, src) == 0);
+	check(ep->includes()->misses() == misses);
+}
+
+int main(){
+	const temp_dir tmp("prefetch");
+	const std::string& dir = tmp.path();
+
+	/* two levels of includes */
+	write_file(dir + "/v.glsl",
+	           "#include \"common.glsl\"\n"
+	           "void main(){ gl_Position = vec4(scale); }\n");
+	write_file(dir + "/f.glsl",
+	           "void main(){ gl_FragColor = vec4(1.0); }\n");
+	write_file(dir + "/common.glsl",
+	           "#include \"deep.glsl\"\n");
+	write_file(dir + "/deep.glsl",
+	           "uniform float scale;\n");
+
+	test_reader(dir, false);
+	test_reader(dir, true);
+
+	glslfx::effect* ep = create(dir);
+	test_effect(ep);
+	delete ep;
+
+	/* files from a provider are already in memory */
+	std::vector<std::string> files;
+	files.push_back(dir + "/v.glsl");
+	files.push_back(dir + "/f.glsl");
+	files.push_back(dir + "/common.glsl");
+	files.push_back(dir + "/deep.glsl");
+
+	glslfx::archive_provider ar;
+	check(glslfx::archive_provider::pack(dir + "/effects.pack", files) == 0);
+	check(ar.load(dir + "/effects.pack") == 0);
+	for ( std::vector<std::string>::const_iterator it = files.begin(); it != files.end(); ++it ){
+		unlink(it->c_str());
+	}
+
+	ep = create(dir);
+	ep->set_file_provider(&ar);
+	test_effect(ep);
+	delete ep;
+
+	return check_result();
+}
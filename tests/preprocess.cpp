@@ -0,0 +1,140 @@
+#include "check.h"
+#include "gl_mock.h"
+#include <glslfx/glslfx.h>
+#include <stdio.h>
+#include <string>
+
+/**
+ * Conditionals on macros predefined by the driver are passed through while
+ * conditionals on macros known by the effect are resolved.
+ */
+
+static bool contains(const std::string& haystack, const char* needle){
+	return haystack.find(needle) != std::string::npos;
+}
+
+int main(){
+	const temp_dir tmp("preprocess");
+	const std::string& dir = tmp.path();
+
+	write_file(dir + "/v.glsl",
+	           "#version 330 core\n"
+	           "#if __VERSION__ >= 300 && defined(GL_core_profile)\n"
+	           "out float a;\n"
+	           "#else\n"
+	           "varying float b;\n"
+	           "#endif\n"
+	           "#ifdef GL_ARB_gpu_shader5\n"
+	           "#define LOCAL 1\n"
+	           "float c;\n"
+	           "#else\n"
+	           "float d;\n"
+	           "#endif\n"
+	           "#if defined(LOCAL)\n"
+	           "float e;\n"
+	           "#endif\n"
+	           "#if USER == 2\n"
+	           "float f;\n"
+	           "#elif GL_EXT_foo\n"
+	           "float g;\n"
+	           "#else\n"
+	           "float h;\n"
+	           "#endif\n"
+	           "void main(){ gl_Position = vec4(0.0); }\n");
+	write_file(dir + "/f.glsl",
+	           "void main(){ gl_FragColor = vec4(1.0); }\n");
+
+	gl_mock_install();
+
+	glslfx::effect ep(dir + "/test.glslfx");
+	glslfx::pass* p = ep.technique_new("t")->pass_new("p");
+	p->set_path(GL_VERTEX_SHADER, "v.glsl");
+	p->set_path(GL_FRAGMENT_SHADER, "f.glsl");
+	p->set_define("USER", "1");
+
+	std::string text;
+	check(p->source(GL_VERTEX_SHADER, text) == 0);
+
+	/* seeded from #version */
+	check(contains(text, "out float a;"));
+	check(!contains(text, "varying float b;"));
+
+	/* left to the driver, with all branches */
+	check(contains(text, "#ifdef GL_ARB_gpu_shader5\n"));
+	check(contains(text, "float c;"));
+	check(contains(text, "float d;"));
+
+	/* defined in a deferred branch, so also left to the driver */
+	check(contains(text, "#if defined(LOCAL)\n"));
+	check(contains(text, "float e;"));
+
+	/* the first deferred #elif starts the conditional seen by the driver */
+	check(!contains(text, "float f;"));
+	check(!contains(text, "USER =="));
+	check(contains(text, "#if GL_EXT_foo\nfloat g;\n#else\nfloat h;\n#endif\n"));
+
+	/* driver messages about the second line refer to the define in the
+	 * vertex shader, which has #version, and to the source itself in the
+	 * fragment shader where defines go first */
+	gl_mock_shader_log = "0:2(1): error: something\n";
+	glslfx::log log;
+	check(ep.compile(&log) == 0);
+	check(log.size() == 2);
+	for ( glslfx::log::const_iterator it = log.begin(); it != log.end(); ++it ){
+		const std::string file = log.file(*it).str();
+		check(( file == "<defines>" && it->line == 1 ) || ( file == dir + "/f.glsl" && it->line == 1 ));
+	}
+	gl_mock_shader_log = "";
+
+	/* #line sets the number of the line following it */
+	write_file(dir + "/l.glsl",
+	           "#version 120\n"
+	           "#line 10\n"
+	           "float x;\n"
+	           "void main(){ gl_Position = vec4(x); }\n");
+	{
+		glslfx::effect lp(dir + "/line.glslfx");
+		glslfx::pass* p = lp.technique_new("t")->pass_new("p");
+		p->set_path(GL_VERTEX_SHADER, "l.glsl");
+		p->set_path(GL_FRAGMENT_SHADER, "l.glsl");
+
+		gl_mock_shader_log = "0:2(1): error: something\n";
+		glslfx::log log;
+		check(lp.compile(&log) == 0);
+		check(log.size() == 2);
+		for ( glslfx::log::const_iterator it = log.begin(); it != log.end(); ++it ){
+			check(log.file(*it).str() == dir + "/l.glsl" && it->line == 10);
+		}
+		gl_mock_shader_log = "";
+	}
+
+	/* a guard with an #else branch doesn't cover the whole file, the
+	 * second include uses the other branch */
+	write_file(dir + "/g.glsl",
+	           "#ifndef G\n"
+	           "#define G\n"
+	           "float first;\n"
+	           "#else\n"
+	           "float second;\n"
+	           "#endif\n");
+	write_file(dir + "/gi.glsl",
+	           "#include \"g.glsl\"\n"
+	           "#include \"g.glsl\"\n"
+	           "void main(){ gl_Position = vec4(0.0); }\n");
+	{
+		glslfx::effect gp(dir + "/guard.glslfx");
+		glslfx::pass* p = gp.technique_new("t")->pass_new("p");
+		p->set_path(GL_VERTEX_SHADER, "gi.glsl");
+
+		std::string text;
+		check(p->source(GL_VERTEX_SHADER, text) == 0);
+		check(contains(text, "float first;"));
+		check(contains(text, "float second;"));
+	}
+
+	if ( failures > 0 ){
+		fprintf(stderr, "%s", text.c_str());
+	}
+
+	return check_result();
+}
@@ -0,0 +1,70 @@
+#include "check.h"
+#include "gl_mock.h"
+#include <glslfx/glslfx.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <string>
+
+/**
+ * Reloading after files are created or changed. The effect is referenced
+ * through "dir/./" while shaders resolve to "dir/", both are the same
+ * watched directory.
+ */
+
+int main(){
+	const temp_dir tmp("reloader");
+	const std::string& dir = tmp.path();
+
+	write_file(dir + "/test.glslfx", "");
+	write_file(dir + "/v.glsl",
+	           "#version 120\n"
+	           "#include \"inc/common.glsl\"\n"
+	           "void main(){ gl_Position = vec4(0.0); }\n");
+	write_file(dir + "/f.glsl",
+	           "#version 120\n"
+	           "void main(){ gl_FragColor = vec4(1.0); }\n");
+
+	gl_mock_install();
+
+	glslfx::effect ep(dir + "/./test.glslfx");
+	glslfx::pass* p = ep.technique_new("t")->pass_new("p");
+	p->set_path(GL_VERTEX_SHADER, "v.glsl");
+	p->set_path(GL_FRAGMENT_SHADER, "f.glsl");
+
+	/* the include and its directory are missing */
+	check(ep.compile(NULL) == ENOENT);
+
+	std::vector<glslfx::pass::dependency> deps;
+	check(p->dependencies(GL_VERTEX_SHADER, deps) == 0);
+	check(deps.size() == 2 && deps.back().path == dir + "/inc/common.glsl" && deps.back().hash == 0);
+
+	glslfx::reloader r(&ep);
+	check(r.watch() == 0);
+
+	check(r.update(NULL) == 0);
+	check(r.rebuilt() == 0);
+
+	/* creating the include rebuilds the pass */
+	check(mkdir((dir + "/inc").c_str(), 0700) == 0);
+	write_file(dir + "/inc/common.glsl", "uniform float t;\n");
+	check(r.update(NULL) == 0);
+	check(r.rebuilt() == 1);
+	check(p->program() != 0);
+
+	/* both spellings of the directory sees changes */
+	write_file(dir + "/f.glsl",
+	           "#version 120\n"
+	           "void main(){ gl_FragColor = vec4(0.25); }\n");
+	check(r.update(NULL) == 0);
+	check(r.rebuilt() == 1);
+	check(!r.effect_changed());
+
+	/* the replaced entry of f.glsl is freed once the pass is rebuilt */
+	check(ep.includes()->retired() == 0);
+
+	write_file(dir + "/test.glslfx", "\n");
+	check(r.update(NULL) == 0);
+	check(r.effect_changed());
+
+	return check_result();
+}
@@ -0,0 +1,57 @@
+#include "check.h"
+#include "gl_mock.h"
+#include <glslfx/glslfx.h>
+#include <string>
+
+/**
+ * Shaders and programs shared between effects through a cache, and
+ * deleted when the last effect using them is destroyed.
+ */
+
+static glslfx::effect* create(const std::string& dir, glslfx::shader_cache* cache){
+	glslfx::effect* ep = new glslfx::effect(dir + "/test.glslfx");
+	glslfx::pass* p = ep->technique_new("t")->pass_new("p");
+	p->set_path(GL_VERTEX_SHADER, "v.glsl");
+	p->set_path(GL_FRAGMENT_SHADER, "f.glsl");
+	ep->set_shader_cache(cache);
+	return ep;
+}
+
+int main(){
+	const temp_dir tmp("shader-cache");
+	const std::string& dir = tmp.path();
+
+	write_file(dir + "/v.glsl",
+	           "#version 120\n"
+	           "void main(){ gl_Position = vec4(0.0); }\n");
+	write_file(dir + "/f.glsl",
+	           "#version 120\n"
+	           "void main(){ gl_FragColor = vec4(1.0); }\n");
+
+	gl_mock_install();
+
+	/* a cache owned by the effect goes with it */
+	glslfx::effect* ep = create(dir, NULL);
+	check(ep->compile(NULL) == 0);
+	check(gl_mock_live_programs == 1 && gl_mock_live_shaders == 2);
+	delete ep;
+	check(gl_mock_live_programs == 0 && gl_mock_live_shaders == 0);
+
+	/* a shared cache keeps objects while any effect uses them */
+	glslfx::shader_cache cache;
+	glslfx::effect* a = create(dir, &cache);
+	glslfx::effect* b = create(dir, &cache);
+	check(a->compile(NULL) == 0);
+	check(b->compile(NULL) == 0);
+	check(cache.programs() == 1 && cache.shaders() == 2);
+	check(gl_mock_live_programs == 1 && gl_mock_live_shaders == 2);
+
+	delete a;
+	check(cache.programs() == 1 && gl_mock_live_programs == 1);
+
+	delete b;
+	check(cache.programs() == 0 && cache.shaders() == 0);
+	check(gl_mock_live_programs == 0 && gl_mock_live_shaders == 0);
+
+	return check_result();
+}
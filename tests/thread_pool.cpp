@@ -0,0 +1,56 @@
+#include "check.h"
+#include <glslfx/thread_pool.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * A pool shared by several callers, eg. effects compiled from different
+ * threads. Batches from concurrent callers must not mix.
+ */
+
+enum { JOBS = 64, ROUNDS = 200 };
+
+typedef struct {
+	glslfx::thread_pool* pool;
+	unsigned int done[JOBS];
+	int ret;
+} caller;
+
+static void job(void* data, size_t index){
+	caller* c = (caller*)data;
+	c->done[index]++;
+}
+
+static void* run(void* arg){
+	caller* c = (caller*)arg;
+
+	for ( unsigned int i = 0; i < ROUNDS && c->ret == 0; i++ ){
+		c->ret = c->pool->run(JOBS, job, c);
+	}
+
+	return NULL;
+}
+
+int main(){
+	glslfx::thread_pool pool(4);
+	caller a, b;
+	pthread_t ta, tb;
+
+	memset(&a, 0, sizeof(a));
+	memset(&b, 0, sizeof(b));
+	a.pool = b.pool = &pool;
+
+	check(pthread_create(&ta, NULL, run, &a) == 0);
+	check(pthread_create(&tb, NULL, run, &b) == 0);
+	pthread_join(ta, NULL);
+	pthread_join(tb, NULL);
+
+	check(a.ret == 0 && b.ret == 0);
+	for ( unsigned int i = 0; i < JOBS; i++ ){
+		check(a.done[i] == ROUNDS);
+		check(b.done[i] == ROUNDS);
+	}
+
+	return check_result();
+}
@@ -0,0 +1,66 @@
+#include "check.h"
+#include "gl_mock.h"
+#include <glslfx/glslfx.h>
+#include <stdio.h>
+#include <string>
+
+/**
+ * Variants built through the public bind path, which passes no log. The
+ * mock driver returns a link log for every program.
+ */
+
+int main(){
+	const temp_dir tmp("variant");
+	const std::string& dir = tmp.path();
+
+	write_file(dir + "/v.glsl",
+	           "#version 120\n"
+	           "#ifdef USE_FOG\n"
+	           "varying float fog;\n"
+	           "#endif\n"
+	           "void main(){ gl_Position = vec4(0.0); }\n");
+	write_file(dir + "/f.glsl",
+	           "#version 120\n"
+	           "void main(){ gl_FragColor = vec4(1.0); }\n");
+
+	gl_mock_install();
+	gl_mock_program_log = "warning: varying fog is written but never read\n";
+
+	glslfx::effect ep(dir + "/test.glslfx");
+	glslfx::pass* p = ep.technique_new("t")->pass_new("p");
+	p->set_path(GL_VERTEX_SHADER, "v.glsl");
+	p->set_path(GL_FRAGMENT_SHADER, "f.glsl");
+	check(p->add_keyword("USE_FOG") == 0);
+	check(ep.compile(NULL) == 0);
+
+	glslfx::pass::variant_key fog = 0;
+	check(p->keyword("USE_FOG", fog) == 0);
+
+	/* built on first use without a log, then served from the table */
+	const unsigned int links = gl_mock_links;
+	check(p->bind(NULL, fog) == 0);
+	check(gl_mock_links == links + 1);
+	check(p->bind(NULL, fog) == 0);
+	check(gl_mock_links == links + 1);
+	p->unbind();
+
+	/* the link log is reported when a log is given */
+	glslfx::log log;
+	GLuint sp;
+	check(p->variant(0, sp, &log) == 0 && sp != 0);
+	check(log.size() == 1);
+
+	/* a keyword which doesn't fit in a variant key fails the parse */
+	std::string fx = "technique t {\n  pass p {\n";
+	for ( unsigned int i = 0; i <= sizeof(glslfx::pass::variant_key) * 8; i++ ){
+		char buf[64];
+		snprintf(buf, sizeof(buf), "    keyword: KEYWORD_%u\n", i);
+		fx += buf;
+	}
+	fx += "  }\n}\n";
+
+	glslfx::effect many(dir + "/many.glslfx");
+	check(many.parse_buffer(fx.data(), fx.size()) == glslfx::E_OUT_OF_RANGE);
+
+		return check_result();
+}